@@ -0,0 +1,216 @@
+/// @file Parse.cpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+///
+/// Reads and parses the procfs files of a CPU tick from a generated tree (see 'ProcFixture') in two ways: with
+/// 'ifstream' and the helpers in 'istream.hpp', as the probes used to, and with 'FileBuffer' and 'Scanner'. Prints
+/// what a tick costs with each, and fails if they do not parse the same values.
+
+#include <unistd.h>
+
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fprd/probes/CPU.hpp>
+#include <fprd/probes/Fixture.hpp>
+#include <fprd/probes/Proc.hpp>
+#include <fprd/probes/Root.hpp>
+#include <fprd/probes/UNIX.hpp>
+#include <fprd/util/file.hpp>
+#include <fprd/util/istream.hpp>
+#include <fprd/util/scanner.hpp>
+#include <fprd/util/to_string.hpp>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace fprd {
+using namespace ::std;
+using namespace ::std::chrono;
+
+/// What a tick parses.
+struct Parsed {
+    probe::CPUUsage usage;
+    vector<float> freqs;
+    uint mem_free{0};
+    vector<ulong> proc_times; // Lifetime CPU time of each process, in the order of the PIDs.
+    vector<char> proc_states;
+
+    bool operator==(const Parsed &p) const {
+        const auto same_usage{[](const probe::CPUUsage::Usage &a, const probe::CPUUsage::Usage &b) {
+            return a.total == b.total && a.idle == b.idle;
+        }};
+        return same_usage(usage.overall, p.usage.overall) &&
+               equal(usage.threads.begin(), usage.threads.end(), p.usage.threads.begin(), same_usage) &&
+               freqs == p.freqs && mem_free == p.mem_free && proc_times == p.proc_times &&
+               proc_states == p.proc_states;
+    }
+};
+
+/// The way the probes parsed procfs before 'Scanner': a fresh 'ifstream' per file, and 'operator>>'.
+class StreamParser {
+    static auto getval(istream &is) {
+        const auto l{getline(is)};
+        return l.substr(l.find(':') + 1);
+    }
+
+  public:
+    /// @param pids
+    /// @param out
+    void tick(const vector<pid_t> &pids, Parsed &out) {
+        {
+            ifstream is{probe_path("/proc/stat")};
+            const auto parse_line{[&]() -> probe::CPUUsage::Usage {
+                skip_to(is, ' ');
+                ulong total{0};
+                ulong idle{0};
+                for (auto i{0}; i < 10; i++) {
+                    const auto l{getulong(is)};
+                    if (i == 3) {
+                        idle += l;
+                    }
+                    total += l;
+                }
+                skip_lines(is, 1);
+                return {total, idle};
+            }};
+            out.usage.overall = parse_line();
+            out.usage.threads.resize(out.freqs.size());
+            for (auto &u : out.usage.threads) {
+                u = parse_line();
+            }
+        }
+        {
+            ifstream is{probe_path("/proc/cpuinfo")};
+            auto freq{out.freqs.begin()};
+            for (string l; freq != out.freqs.end() && std::getline(is, l);) {
+                if (l.starts_with("cpu MHz")) {
+                    *freq++ = std::stof(l.substr(l.find(':') + 1));
+                }
+            }
+        }
+        {
+            ifstream is{probe_path("/proc/meminfo")};
+            skip_lines(is, 1);
+            out.mem_free = static_cast<uint>(std::stoul(getval(is)));
+        }
+        out.proc_times.clear();
+        out.proc_states.clear();
+        for (auto pid : pids) {
+            ifstream is{probe_path("/proc/" + to_string(pid) + "/stat")};
+            skip_to(is, ')');
+            out.proc_states.push_back(getchar(is));
+            // ppid, pgrp, session, tty_nr, tpgid, flags, minflt, cminflt, majflt, cmajflt.
+            for (auto i{0}; i < 11; i++) {
+                skip_to(is, ' ');
+            }
+            ulong sum{0};
+            for (auto i{0}; i < 4; i++) {
+                sum += getulong(is);
+            }
+            out.proc_times.push_back(sum);
+        }
+    }
+};
+
+/// The way the probes parse procfs now.
+class ScannerParser {
+    FileBuffer buf{1 << 16};
+    array<char, 1024> proc_buf;
+    const string stat{probe_path("/proc/stat")};
+    const string cpuinfo{probe_path("/proc/cpuinfo")};
+    const string meminfo{probe_path("/proc/meminfo")};
+    ProcDir dir;
+
+  public:
+    /// @param pids
+    /// @param out
+    void tick(const vector<pid_t> &pids, Parsed &out) {
+        out.usage.threads.resize(out.freqs.size());
+        probe::get_cpu_lifetime_usage(buf.read(stat.c_str()), out.usage);
+        probe::get_cpu_freqs(buf.read(cpuinfo.c_str()), out.freqs);
+        {
+            Scanner s{buf.read(meminfo.c_str())};
+            s.skip_lines(1);
+            out.mem_free = stou<uint>(s.getval());
+        }
+        out.proc_times.clear();
+        out.proc_states.clear();
+        for (auto pid : pids) {
+            const auto p{parse_proc_stat(dir.read(pid, "stat", proc_buf))};
+            out.proc_states.push_back(p.state);
+            out.proc_times.push_back(static_cast<ulong>(p.cpu_time()));
+        }
+    }
+};
+
+/// @param arg
+/// @param fallback
+/// @return uint 'arg' as a number, or 'fallback' if it is missing.
+uint parse_arg(const char *arg, uint fallback) {
+    uint n{fallback};
+    if (arg != nullptr) {
+        from_chars(arg, arg + strlen(arg), n);
+    }
+    return n;
+}
+}; // namespace fprd
+
+int main(int argc, char **argv) {
+    using namespace ::fprd;
+    if (argc > 4) {
+        cerr << "Usage: parse [PROCESSES [CPUS [TICKS]]]" << endl;
+        return 1;
+    }
+    const ProcFixture::Params params{
+        .cpus = parse_arg(argc > 2 ? argv[2] : nullptr, 8),
+        .processes = parse_arg(argc > 1 ? argv[1] : nullptr, 1000),
+        .churn = 0,
+    };
+    const auto ticks{parse_arg(argc > 3 ? argv[3] : nullptr, 20)};
+
+    const auto root{filesystem::temp_directory_path() / ("fprd-parse-" + to_string(::getpid()))};
+    ProcFixture fixture{root, params};
+    probe_root() = root.string();
+
+    auto ok{true};
+    {
+        vector<pid_t> pids;
+        ProcDir{}.for_each_pid([&](pid_t pid) { pids.push_back(pid); });
+
+        StreamParser streams;
+        ScannerParser scanner;
+        Parsed a;
+        Parsed b;
+        a.freqs.resize(params.cpus);
+        b.freqs.resize(params.cpus);
+        duration<double, milli> stream_time{0};
+        duration<double, milli> scanner_time{0};
+        for (uint i{0}; i < ticks; i++) {
+            fixture.tick();
+            auto start{steady_clock::now()};
+            streams.tick(pids, a);
+            stream_time += steady_clock::now() - start;
+            start = steady_clock::now();
+            scanner.tick(pids, b);
+            scanner_time += steady_clock::now() - start;
+            if (!(a == b)) {
+                cerr << "Tick " << i << ": the parsers disagree." << endl;
+                ok = false;
+            }
+        }
+
+        cout << params.processes << " processes, " << params.cpus << " CPUs, per tick:" << endl;
+        cout << "ifstream: " << ftos<3>(stream_time.count() / ticks) << "ms" << endl;
+        cout << "Scanner:  " << ftos<3>(scanner_time.count() / ticks) << "ms" << endl;
+    }
+
+    filesystem::remove_all(root);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+/// @file ProcRead.cpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+///
+/// Reads '<pid>/stat' of every process in a generated tree (see 'ProcFixture') with a 'ProcStatReader' that uses
+/// io_uring and with one that reads the files one by one. Prints what a tick costs with each, and fails if they do
+/// not read the same contents. By default, the tree has 50000 processes, more than most systems.
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fprd/probes/Fixture.hpp>
+#include <fprd/probes/Proc.hpp>
+#include <fprd/probes/ProcReader.hpp>
+#include <fprd/probes/Root.hpp>
+#include <fprd/util/to_string.hpp>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fprd {
+using namespace ::std;
+using namespace ::std::chrono;
+
+/// What a reader read in a tick, sorted by PID.
+using Contents = vector<pair<pid_t, string>>;
+
+/// @param reader
+/// @param pids
+/// @param out
+/// @return duration<double, milli> How long the reads took.
+duration<double, milli> read(ProcStatReader &reader, const vector<pid_t> &pids, Contents &out) {
+    out.clear();
+    const auto start{steady_clock::now()};
+    reader.read_all(pids, [&](pid_t pid, string_view contents) { out.emplace_back(pid, contents); });
+    const duration<double, milli> elapsed{steady_clock::now() - start};
+    sort(out.begin(), out.end());
+    return elapsed;
+}
+
+/// @param arg
+/// @param fallback
+/// @return uint 'arg' as a number, or 'fallback' if it is missing.
+uint parse_arg(const char *arg, uint fallback) {
+    uint n{fallback};
+    if (arg != nullptr) {
+        from_chars(arg, arg + strlen(arg), n);
+    }
+    return n;
+}
+}; // namespace fprd
+
+int main(int argc, char **argv) {
+    using namespace ::fprd;
+    if (argc > 4) {
+        cerr << "Usage: proc-read [PROCESSES [TICKS [CHURN%]]]" << endl;
+        return 1;
+    }
+    const ProcFixture::Params params{
+        .cpus = 1,
+        .processes = parse_arg(argc > 1 ? argv[1] : nullptr, 50000),
+        .churn = static_cast<float>(parse_arg(argc > 3 ? argv[3] : nullptr, 1)) / 100,
+    };
+    const auto ticks{parse_arg(argc > 2 ? argv[2] : nullptr, 10)};
+
+    const auto root{filesystem::temp_directory_path() / ("fprd-proc-read-" + to_string(::getpid()))};
+    ProcFixture fixture{root, params};
+    probe_root() = root.string();
+
+    auto ok{true};
+    {
+        ProcDir dir;
+        ProcStatReader batched{dir};
+        ProcStatReader sync{dir, 1, false};
+        if (!batched.is_batched()) {
+            cout << "io_uring is unavailable. Both readers read the files one by one." << endl;
+        }
+
+        vector<pid_t> pids;
+        Contents a;
+        Contents b;
+        duration<double, milli> batched_time{0};
+        duration<double, milli> sync_time{0};
+        for (uint i{0}; i < ticks; i++) {
+            fixture.tick();
+            pids.clear();
+            dir.for_each_pid([&](pid_t pid) { pids.push_back(pid); });
+            batched_time += read(batched, pids, a);
+            sync_time += read(sync, pids, b);
+            if (a.size() != pids.size() || a != b) {
+                cerr << "Tick " << i << ": the readers disagree." << endl;
+                ok = false;
+            }
+        }
+
+        cout << params.processes << " processes, " << ftos<1>(params.churn * 100) << "% churn, per tick:" << endl;
+        cout << "io_uring:   " << ftos<3>(batched_time.count() / ticks) << "ms" << endl;
+        cout << "one by one: " << ftos<3>(sync_time.count() / ticks) << "ms" << endl;
+    }
+
+    filesystem::remove_all(root);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+/// @file ProcScan.cpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+///
+/// Runs the CPU probe against a generated '/proc' tree (see 'ProcFixture') and prints what a tick costs, with and
+/// without a process scan. The input is the same on every run, so the numbers can be compared across changes.
+/// Fails if the usage that the probe reports is not what the fixture made the processes use.
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <fprd/probes/CPU.hpp>
+#include <fprd/probes/Fixture.hpp>
+#include <fprd/probes/Root.hpp>
+#include <fprd/util/HashMap.hpp>
+#include <fprd/util/to_string.hpp>
+#include <functional>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+namespace fprd {
+using namespace ::std;
+using namespace ::std::chrono;
+
+/// What the ticks of one kind cost.
+struct Timings {
+    size_t count{0};
+    duration<double, milli> total{0};
+    duration<double, milli> max{0};
+
+    /// @param d
+    void add(duration<double, milli> d) {
+        count++;
+        total += d;
+        max = std::max(max, d);
+    }
+
+    /// @param os
+    /// @param name
+    void print(ostream &os, string_view name) const {
+        os << name << ": " << count << " ticks";
+        if (count != 0) {
+            os << ", " << ftos<3>(total.count() / static_cast<double>(count)) << "ms on average, "
+               << ftos<3>(max.count()) << "ms at most";
+        }
+        os << endl;
+    }
+};
+
+/// The usage that the probe should report, from the times in the fixture.
+class Expected {
+    /// Lifetime CPU time of each process at the last scan.
+    HashMap<pid_t, ulong, IntHash> times;
+    /// Busy time of all CPUs at the last scan.
+    ulong busy{0};
+    /// % usage of each process since the last scan.
+    HashMap<pid_t, float, IntHash> usages;
+    /// 'usages' from the highest.
+    vector<float> sorted;
+
+  public:
+    /// Take the times of the fixture at a scan of the probe.
+    /// @param fixture
+    void scan(const ProcFixture &fixture) {
+        usages.clear();
+        sorted.clear();
+        const auto d_busy{static_cast<float>(fixture.busy_time() - busy)};
+        fixture.for_each_process([&](pid_t pid, ulong time) {
+            const auto *const last{times.find(pid)};
+            // A process that is new since the last scan used all of its time since then.
+            if (const auto diff{time - (last != nullptr ? *last : 0)}; diff != 0) {
+                const auto usage{static_cast<float>(diff) / d_busy * 100};
+                usages.try_emplace(pid).first = usage;
+                sorted.push_back(usage);
+            }
+        });
+        sort(sorted.begin(), sorted.end(), greater{});
+
+        busy = fixture.busy_time();
+        times.clear();
+        fixture.for_each_process([this](pid_t pid, ulong time) { times.try_emplace(pid).first = time; });
+    }
+
+    /// @param procs As reported by the probe at the last scan.
+    /// @param os Where to tell what is wrong.
+    /// @return bool True if the shown processes are the busiest, with the usage they had.
+    bool check(const vector<probe::CPU<16>::Process> &procs, ostream &os) {
+        auto ok{true};
+        size_t shown{0};
+        float total{0};
+        for (const auto &p : procs) {
+            // Groups of processes that exited come from the exit records of the real system.
+            if (p.pid == 0) {
+                continue;
+            }
+            const auto *const usage{usages.find(p.pid)};
+            // Both divide the same integers, so anything but rounding is a bug.
+            if (usage == nullptr || abs(p.usage - *usage) > *usage * 1e-4F) {
+                os << "Process " << p.pid << " is shown at " << p.usage << "% instead of "
+                   << (usage != nullptr ? *usage : 0) << "%." << endl;
+                ok = false;
+            }
+            shown++;
+            total += p.usage;
+        }
+        // The shown processes must be the busiest ones.
+        float expected{0};
+        for (size_t i{0}; i < min(shown, sorted.size()); i++) {
+            expected += sorted[i];
+        }
+        if (abs(total - expected) > expected * 1e-4F || (shown == 0 && !sorted.empty())) {
+            os << "The shown processes add up to " << total << "% instead of " << expected << "%." << endl;
+            ok = false;
+        }
+        return ok;
+    }
+};
+
+/// @param arg
+/// @param fallback
+/// @return uint 'arg' as a number, or 'fallback' if it is missing.
+uint parse_arg(const char *arg, uint fallback) {
+    if (arg == nullptr) {
+        return fallback;
+    }
+    uint n{fallback};
+    from_chars(arg, arg + char_traits<char>::length(arg), n);
+    return n;
+}
+}; // namespace fprd
+
+int main(int argc, char **argv) {
+    using namespace ::fprd;
+    if (argc > 5) {
+        cerr << "Usage: proc-scan [PROCESSES [CPUS [TICKS [CHURN%]]]]" << endl;
+        return 1;
+    }
+    const ProcFixture::Params params{
+        .cpus = parse_arg(argc > 2 ? argv[2] : nullptr, 8),
+        .processes = parse_arg(argc > 1 ? argv[1] : nullptr, 1000),
+        .churn = static_cast<float>(parse_arg(argc > 4 ? argv[4] : nullptr, 1)) / 100,
+    };
+    const auto ticks{parse_arg(argc > 3 ? argv[3] : nullptr, 40)};
+
+    const auto root{filesystem::temp_directory_path() / ("fprd-proc-scan-" + to_string(::getpid()))};
+    ProcFixture fixture{root, params};
+    probe_root() = root.string();
+
+    auto ok{true};
+    {
+        probe::CPU<16> cpu;
+        probe::CPU<16>::DynamicData d{};
+        Timings plain;
+        Timings scans;
+        Expected expected;
+        for (uint i{0}; i < ticks; i++) {
+            fixture.tick();
+            const auto start{steady_clock::now()};
+            cpu.update(d);
+            (d.scanned ? scans : plain).add(steady_clock::now() - start);
+
+            for (const auto &t : d.threads) {
+                if (t.usage < 0 || t.usage > 1) {
+                    cerr << "Tick " << i << ": a CPU is " << t.usage * 100 << "% busy." << endl;
+                    ok = false;
+                }
+            }
+            if (d.scanned) {
+                expected.scan(fixture);
+                if (!expected.check(d.procs, cerr)) {
+                    cerr << "Tick " << i << ": the usage of the processes is wrong." << endl;
+                    ok = false;
+                }
+            }
+        }
+
+        cout << params.processes << " processes, " << params.cpus << " CPUs, "
+             << ftos<1>(params.churn * 100) << "% churn" << endl;
+        plain.print(cout, "Without a scan");
+        scans.print(cout, "With a scan");
+    }
+
+    filesystem::remove_all(root);
+    return ok ? 0 : 1;
+}
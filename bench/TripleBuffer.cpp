@@ -0,0 +1,145 @@
+/// @file TripleBuffer.cpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+///
+/// A producer publishes to a 'TripleBuffer' as fast as it can, while the consumer takes so slowly that most values
+/// are overwritten, like a stressed probe against a long 'update_data'. Fails if the consumer ever sees a value
+/// that is torn, old or taken twice, or if 'take' reports something new when nothing was published.
+
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fprd/util/TripleBuffer.hpp>
+#include <fprd/util/to_string.hpp>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace fprd {
+using namespace ::std;
+using namespace ::std::chrono;
+
+/// Every element is 'seq', so a value with a mix of two publishes shows.
+struct Snapshot {
+    uint64_t seq{0};
+    vector<uint64_t> values;
+};
+
+/// @param s
+/// @return bool True if 's' was written by a single publish.
+bool complete(const Snapshot &s) {
+    for (auto v : s.values) {
+        if (v != s.seq) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// @param b
+/// @param seq
+void produce(TripleBuffer<Snapshot> &b, uint64_t seq) {
+    auto &s{b.back_buffer()};
+    s.seq = seq;
+    s.values.assign(256, seq);
+    b.publish();
+}
+
+/// Without a second thread, 'take' must see exactly the publishes.
+/// @return bool
+bool check_sequential() {
+    TripleBuffer<Snapshot> b;
+    auto ok{true};
+    const auto expect{[&](bool took, uint64_t seq, const char *what) {
+        if (took != (seq != 0) || (took && b.front_buffer().seq != seq)) {
+            cerr << what << ": took " << took << ", seq " << b.front_buffer().seq << endl;
+            ok = false;
+        }
+    }};
+    expect(b.take(), 0, "Before any publish");
+    produce(b, 1);
+    expect(b.take(), 1, "After one publish");
+    expect(b.take(), 0, "Taken again");
+    produce(b, 2);
+    produce(b, 3);
+    produce(b, 4);
+    expect(b.take(), 4, "After three publishes");
+    expect(b.take(), 0, "Taken again");
+    return ok;
+}
+
+/// @param publishes
+/// @param slowness How long the consumer takes for each value it takes.
+/// @return bool
+bool check_contended(uint64_t publishes, microseconds slowness) {
+    TripleBuffer<Snapshot> b;
+    atomic<bool> done{false};
+    duration<double, micro> slowest_publish{0};
+
+    const auto start{steady_clock::now()};
+    thread producer{[&] {
+        for (uint64_t seq{1}; seq <= publishes; seq++) {
+            const auto t{steady_clock::now()};
+            produce(b, seq);
+            slowest_publish = max<duration<double, micro>>(slowest_publish, steady_clock::now() - t);
+        }
+        done = true;
+    }};
+
+    auto ok{true};
+    uint64_t last{0};
+    uint64_t taken{0};
+    uint64_t empty{0};
+    while (true) {
+        // Read before taking: if the producer was done before, its last value must be there to take.
+        const bool finished{done};
+        if (!b.take()) {
+            if (finished) {
+                break;
+            }
+            empty++;
+            this_thread::yield();
+            continue;
+        }
+        const auto &s{b.front_buffer()};
+        if (!complete(s) || s.seq <= last) {
+            cerr << "Took " << s.seq << " after " << last << (complete(s) ? "" : ", torn") << endl;
+            ok = false;
+        }
+        last = s.seq;
+        taken++;
+        // A long 'update_data'.
+        for (const auto until{steady_clock::now() + slowness}; steady_clock::now() < until;) {
+        }
+    }
+    producer.join();
+    const duration<double> elapsed{steady_clock::now() - start};
+
+    if (last != publishes) {
+        cerr << "The last value taken is " << last << " of " << publishes << endl;
+        ok = false;
+    }
+    cout << publishes << " publishes in " << ftos<3>(elapsed.count()) << "s, at most "
+         << ftos<1>(slowest_publish.count()) << "us each. " << taken << " taken, " << empty
+         << " times nothing new." << endl;
+    return ok;
+}
+}; // namespace fprd
+
+int main(int argc, char **argv) {
+    using namespace ::fprd;
+    uint64_t publishes{1'000'000};
+    if (argc > 2 || (argc == 2 && from_chars(argv[1], argv[1] + strlen(argv[1]), publishes).ec != errc{})) {
+        cerr << "Usage: triple-buffer [PUBLISHES]" << endl;
+        return 1;
+    }
+    auto ok{check_sequential()};
+    ok = check_contended(publishes, 100us) && ok;
+    return ok ? 0 : 1;
+}
@@ -30,7 +30,18 @@ class CPU {
 
   public:
     using DynamicData = typename Probe::DynamicData;
-    static constexpr auto probe_interval{1s};
+    static inline const auto probe_interval{cpu_probe_interval};
+
+    /// What is shown besides 'DynamicData'.
+    struct StaticData {
+        string name;
+        size_t thread_count;
+        int mem_total; // KB
+
+        /// @param s
+        /// @return auto
+        static auto fields(auto &s) { return tie(s.name, s.thread_count, s.mem_total); }
+    };
 
     static constexpr auto w{256};
     static constexpr auto cores_row{theme::medium_area(w)};
@@ -44,50 +55,74 @@ class CPU {
     const Position<int> pos;
 
   private:
-    Probe probe;
+    const StaticData info;
+    /// Null when showing recorded data.
+    unique_ptr<Probe> probe;
 
     vector<AnimatedBar<Orientation::horizontal, Direction::positive>> core_usages;
     vector<Text<VerticalAlign::center>> core_freqs;
     vector<AnimatedValue<ushort>> core_freqs_v;
     AnimatedGraph<128> usage;
-    AnimatedValue<float> temp_v{};
+    AnimatedValue<float> temp_v{0.1F};
     Text<VerticalAlign::center> temp;
     AnimatedGraph<128> memory;
-    AnimatedValue<int> memory_v{};
+    AnimatedValue<int> memory_v{1000}; // KB, shown in GB.
     Text<VerticalAlign::center> memory_value;
     const string total_memory;
     unique_ptr<ProcList> procs;
 
-  public:
-    CPU(Position<int> pos)
-        : pos{pos}, probe{}, usage{{{0, theme::large_h + 3 + cores_row.h * cores_rows},
-                                    graph_area,
-                                    theme::grey,
-                                    1,
-                                    theme::red,
-                                    theme::black}},
+    /// @param pos
+    /// @param info
+    /// @param probe
+    CPU(Position<int> pos, StaticData info, unique_ptr<Probe> probe)
+        : pos{pos}, info{move(info)}, probe{move(probe)},
+          usage{{{0, theme::large_h + 3 + cores_row.h * cores_rows},
+                 graph_area,
+                 theme::grey,
+                 1,
+                 theme::red,
+                 theme::black}},
           memory{{{0, theme::large_h + 3 + cores_row.h * cores_rows + graph_area.h},
                   graph_area,
                   theme::grey,
                   1,
                   theme::green,
                   theme::black}},
-          total_memory{"/" + ftos<1>((float)probe.mem_total / 1000000) + "GB"} {}
+          total_memory{"/" + ftos<1>((float)this->info.mem_total / 1000000) + "GB"} {}
 
-    void update_data(const DynamicData &d) {
+    /// @param pos
+    /// @param probe
+    CPU(Position<int> pos, unique_ptr<Probe> probe)
+        : CPU{pos, StaticData{probe->name, probe->thread_count, probe->mem_total}, move(probe)} {}
+
+  public:
+    /// Show the live system.
+    /// @param pos
+    CPU(Position<int> pos) : CPU{pos, make_unique<Probe>()} {}
+    /// Show recorded data. 'get_data' must not be called.
+    /// @param pos
+    /// @param info
+    CPU(Position<int> pos, StaticData info) : CPU{pos, move(info), nullptr} {}
+
+    /// @return const StaticData&
+    [[nodiscard]] const StaticData &static_data() const { return info; }
+
+    void update_data(DynamicData &d) {
         for (auto [ts, b, f] : zip(d.threads, core_usages, core_freqs_v)) {
             b.update(ts.usage * 100);
             f.update(ts.freq);
         }
         usage.update(d.avg.usage * 100);
 
-        const auto mem_usage{static_cast<float>(probe.mem_total - d.mem_free) /
-                             static_cast<float>(probe.mem_total)};
+        const auto mem_usage{static_cast<float>(info.mem_total - d.mem_free) /
+                             static_cast<float>(info.mem_total)};
         memory.update(mem_usage * 100);
-        memory_v.update(probe.mem_total - d.mem_free);
+        memory_v.update(info.mem_total - d.mem_free);
         temp_v.update(d.temp);
 
-        procs->update(d.procs);
+        if (d.scanned) {
+            procs->update(d.procs);
+        }
     }
 
     void draw(Window &w, bool new_data) {
@@ -95,30 +130,30 @@ class CPU {
             b.draw(w);
         }
         for (auto [v, f] : zip(core_freqs_v, core_freqs)) {
-            f.draw(w, width<4>(to_string(v.draw())) + "MHz");
+            f.draw(w, width<4>(to_string(v.draw(w))) + "MHz");
         }
         usage.draw(w);
         memory.draw(w);
         procs->draw(w);
-        memory_value.draw(w, ftos<3>((float)memory_v.draw() / 1000000) + total_memory);
-        temp.draw(w, ftos<1>(temp_v.draw()) + "℃");
+        memory_value.draw(w, ftos<3>((float)memory_v.draw(w) / 1000000) + total_memory);
+        temp.draw(w, ftos<1>(temp_v.draw(w)) + "℃");
     }
 
-    DynamicData get_data() { return probe.update(); };
+    void get_data(DynamicData &d) { probe->update(d); };
 
     Window create_window() {
         Window w{":0.0", pos, area};
 
         Text<VerticalAlign::center> t{{&theme::bold, {0, 0}, theme::large_area(area.w)}, theme::red};
         draw_text_once(w, t, [&] {
-            const auto name{probe.name};
+            const auto name{info.name};
             const string_view start{"Core(TM)"};
             const auto spos{name.find(start) + start.size()};
             const auto epos{name.find("CPU") - 1};
             return "Intel" + name.substr(spos, epos - spos);
         }());
 
-        const auto cores_per_row{probe.thread_count / cores_rows};
+        const auto cores_per_row{info.thread_count / cores_rows};
 
         Margin<float> m{1, 1};
         const Area<float> core_area{cores_row.scale({1.0F / cores_per_row, 1.0F})};
@@ -130,7 +165,7 @@ class CPU {
             .filled = theme::red,
         };
         Text<VerticalAlign::center> tc{{&theme::normal, {}, core_area.pad(m)}, theme::white};
-        for (auto i{0U}; i < probe.thread_count; i++) {
+        for (auto i{0U}; i < info.thread_count; i++) {
             const auto x{i / cores_per_row};
             const auto y{i % cores_per_row};
 
@@ -140,7 +175,7 @@ class CPU {
             tc.pos = pos;
             core_freqs.emplace_back(tc);
         }
-        core_freqs_v.resize(probe.thread_count);
+        core_freqs_v.resize(info.thread_count);
 
         memory_value = tc;
         memory_value.area = theme::medium_area(area.w);
@@ -165,6 +200,6 @@ class CPUWindow {
   public:
     static constexpr Area<int> area{CPU::area};
 
-    CPUWindow(atomic<bool> &run, Position<int> pos) : c{pos}, t{run, c} {}
+    CPUWindow(Scheduler &s, Position<int> pos) : c{pos}, t{s, c} {}
 };
 }; // namespace fprd
\ No newline at end of file
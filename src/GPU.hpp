@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <fprd/Config.hpp>
 #include <fprd/Threads.hpp>
 #include <fprd/Types.hpp>
@@ -15,12 +17,15 @@
 #include <fprd/draw/ArcBar.hpp>
 #include <fprd/draw/Text.hpp>
 #include <fprd/draw/animated/AArcBar.hpp>
+#include <fprd/draw/animated/ASampleGraph.hpp>
 #include <fprd/draw/animated/AnimatedList.hpp>
 #include <fprd/probes/NVML.hpp>
 #include <fprd/util/AnimatedValue.hpp>
 #include <fprd/util/ranges.hpp>
 #include <fprd/util/to_string.hpp>
+#include <mutex>
 #include <numbers>
+#include <optional>
 #include <random>
 #include <ranges>
 
@@ -29,13 +34,33 @@ class GPU {
   public:
     static constexpr auto max_procs{5};
     using Device = nvml::Device<max_procs>;
+    using Query = Device::Query;
 
     using DynamicData = vector<Device::DynamicData>;
     static constexpr auto probe_interval{1s};
 
+    /// What is shown of a device besides its 'DynamicData'.
+    struct DeviceInfo {
+        string name;
+        float memory_total; // GB
+        /// The rest are shown as "n/a".
+        Device::Queries supported;
+
+        /// @param i
+        /// @return auto
+        static auto fields(auto &i) { return tie(i.name, i.memory_total, i.supported); }
+    };
+    using StaticData = vector<DeviceInfo>;
+
     static constexpr auto circle_radious{128};
     static constexpr Area<float> circle_area{circle_radious * 2, circle_radious * 2};
     static constexpr Area<float> proc_line{theme::small_area(circle_area.w)};
+    /// The driver samples utilization about 6 times a second, so this is about 20 seconds.
+    static constexpr short graph_samples{128};
+    static constexpr Area<float> graph_area{circle_area.w, 32};
+    /// Of each device.
+    static constexpr Area<float> widget_area{circle_area.w,
+                                             circle_area.h + proc_line.h * (max_procs + 1) + graph_area.h};
 
   private:
     /// One widget for each GPU device.
@@ -45,8 +70,14 @@ class GPU {
         static inline const cairo::Image ico_temp{resources / "icons/Nature/049-thermometer.png", theme::red};
         static inline const cairo::Image ico_fan{resources / "icons/Computer/054-cooler.png", theme::blue};
 
-        Widget(Window &w, const Device &d, Position<float> pos, Area<float> area)
-            : d{d}, list{w, pos.offset({0, circle_area.h}), proc_line.scale({1, max_procs + 1})} {
+        Widget(Window &w, const DeviceInfo &d, Position<float> pos, Area<float> area)
+            : d{d}, list{w, pos.offset({0, circle_area.h}), proc_line.scale({1, max_procs + 1})},
+              samples{{pos.offset({0, circle_area.h + proc_line.h * (max_procs + 1)}),
+                       graph_area,
+                       theme::grey,
+                       1,
+                       theme::green,
+                       theme::black}} {
             using namespace ::std::numbers;
 
             const auto center{pos.offset({circle_radious, circle_radious})};
@@ -98,6 +129,16 @@ class GPU {
             };
             draw_text_once(w, t, d.name);
 
+            const auto status_area{theme::medium_area(gpu_name.w)};
+            stale = {{&theme::normal, status_area.center(center.offset({0, gpu_name.h})), status_area},
+                     theme::red,
+                     theme::black};
+            alert = {{&theme::normal,
+                      status_area.center(center.offset({0, gpu_name.h + status_area.h})),
+                      status_area},
+                     theme::yellow,
+                     theme::black};
+
             tb.area = theme::medium_area(inner_edge.x);
             {
                 auto tpos{center.offset(inner_edge.scale({-1, -1}))};
@@ -122,7 +163,7 @@ class GPU {
             }
             w.draw(ico_fan, icon_size.bottom_right(center.offset(inner_edge.scale({1, 1}))), icon_size);
         }
-        const Device &d;
+        const DeviceInfo &d;
 
         AnimatedArcBar<ArcBarDirection::clock_wise> usage;
         TextCleared<VerticalAlign::right> usage_percent;
@@ -131,30 +172,83 @@ class GPU {
 
         AnimatedArcBar<ArcBarDirection::counter_clock_wise> memory_usage;
         TextCleared<VerticalAlign::right> memory_usage_percent;
-        AnimatedValue<float> memv;
+        AnimatedValue<float> memv{0.001F};
         TextCleared<VerticalAlign::left> mem_usage;
 
         AnimatedArcBar<ArcBarDirection::counter_clock_wise> temp;
         TextCleared<VerticalAlign::right> temp_celsius;
-        AnimatedValue<float> wattsv;
+        AnimatedValue<float> wattsv{0.1F};
         TextCleared<VerticalAlign::right> watts;
 
         AnimatedArcBar<ArcBarDirection::clock_wise> fan;
         TextCleared<VerticalAlign::right> fan_percent;
 
+        /// Shown while the device does not answer in time, or while the process list is stale.
+        TextCleared<VerticalAlign::center> stale;
+        ushort stale_count{0};
+        /// Of the latest data. Shown as "n/a" until they work again.
+        Device::Queries failed;
+
+        /// The last alert from an event, shown until 'alert_until'.
+        TextCleared<VerticalAlign::center> alert;
+        string alert_text; // Empty once it was cleared.
+        time_point<high_resolution_clock> alert_until;
+
         AnimatedList<Device::Process, max_procs> list;
+
+        /// Every utilization sample of the driver.
+        AnimatedSampleGraph<graph_samples> samples;
     };
 
     Position<int> pos;
-    nvml::NVML nvml;
+    /// Empty when showing recorded data.
+    optional<nvml::NVML> nvml;
     vector<Device> devices;
+    StaticData infos;
+    /// Null when showing recorded data.
+    unique_ptr<nvml::Prober<max_procs>> prober;
     vector<Widget> widgets;
 
-  public:
-    GPU(Position<int> pos) : pos{pos}, nvml{}, devices{nvml.get_devices<max_procs>()} {}
+    mutex alerts_m;
+    /// Of each device. Set by the event thread, taken by the next frame.
+    vector<optional<Device::Alert>> alerts;
+    /// Set with 'alerts', so that the next frame is drawn even if nothing else changed.
+    atomic<bool> new_alerts{false};
+    /// Null when showing recorded data.
+    unique_ptr<nvml::Events<max_procs>> events;
 
-    void update_data(const DynamicData &d) {
+  public:
+    /// Show the live system.
+    /// @param pos
+    GPU(Position<int> pos)
+        : pos{pos}, nvml{in_place}, devices{nvml->get_devices<max_procs>()}, infos{[this] {
+              StaticData infos;
+              for (const auto &d : devices) {
+                  infos.push_back({d.name, d.memory_total, d.supported});
+              }
+              return infos;
+          }()},
+          prober{make_unique<nvml::Prober<max_procs>>(devices, gpu_probe_threads)}, alerts(devices.size()),
+          events{make_unique<nvml::Events<max_procs>>(devices, [this](size_t i, Device::Alert a) {
+              lock_guard lg{alerts_m};
+              alerts[i] = move(a);
+              new_alerts = true;
+          })} {}
+    /// Show recorded data, without NVML. 'get_data' must not be called.
+    /// @param pos
+    /// @param infos
+    GPU(Position<int> pos, StaticData infos) : pos{pos}, infos{move(infos)}, alerts(this->infos.size()) {}
+
+    /// @return const StaticData&
+    [[nodiscard]] const StaticData &static_data() const { return infos; }
+
+    void update_data(DynamicData &d) {
         for (auto [data, widget] : zip(d, widgets)) {
+            widget.stale_count = data.stale;
+            // The device did not answer, so there is nothing new to show.
+            if (data.stale != 0) {
+                continue;
+            }
             widget.usage.update(data.utilization);
             widget.freqv.update(data.clock);
 
@@ -166,48 +260,105 @@ class GPU {
 
             widget.fan.update(data.fan);
 
-            widget.list.update(data.procs);
+            // A process list that could not be read is not replaced by what little was read of it.
+            if (!data.failed.has(Query::processes)) {
+                widget.list.update(data.procs);
+            }
+            widget.samples.update(data.utilization_samples);
+
+            widget.failed = data.failed;
+        }
+    }
+    /// Apply the alerts from events, without waiting for the next probe.
+    void take_alerts() {
+        if (!new_alerts.exchange(false)) {
+            return;
+        }
+        lock_guard lg{alerts_m};
+        for (auto [alert, widget] : zip(alerts, widgets)) {
+            if (!alert) {
+                continue;
+            }
+            if (alert->clock != 0) {
+                widget.freqv.update(static_cast<short>(alert->clock));
+            }
+            if (!alert->text.empty()) {
+                widget.alert_text = move(alert->text);
+                widget.alert_until = now() + gpu_alert_duration;
+            }
+            alert.reset();
+        }
+    }
+
+    /// @return bool True if an alert came, or one is to be cleared.
+    bool has_news() {
+        if (new_alerts) {
+            return true;
         }
+        const auto tp{now()};
+        return any_of(widgets.begin(), widgets.end(),
+                      [tp](const Widget &w) { return !w.alert_text.empty() && tp >= w.alert_until; });
     }
+
     void draw(Window &w, bool new_data) {
+        take_alerts();
+        const auto tp{now()};
         for (auto &widget : widgets) {
+            const auto &supported{widget.d.supported};
+            // "n/a" unless the device supports the query, and answered it this time.
+            const auto or_na{[&](Query q, auto text) -> string {
+                return supported.has(q) && !widget.failed.has(q) ? text() : "n/a";
+            }};
+
             widget.usage.draw(w);
-            widget.usage_percent.draw(w, ftos<0>(widget.usage.current_percentage()) + "%");
-            widget.freq.draw(w, width<4>(to_string(widget.freqv.draw())) + "MHz");
+            widget.usage_percent.draw(
+                w, or_na(Query::utilization, [&] { return ftos<0>(widget.usage.current_percentage()) + "%"; }));
+            widget.freq.draw(w, or_na(Query::clock, [&] {
+                                 return width<4>(to_string(widget.freqv.draw(w))) + "MHz";
+                             }));
 
             widget.memory_usage.draw(w);
-            widget.memory_usage_percent.draw(w, ftos<0>(widget.memory_usage.current_percentage()) + "%");
-            widget.mem_usage.draw(w, width<5>(ftos<3>(widget.memv.draw())) + "/" + ftos<0>(widget.d.memory_total) +
-                                         "GB");
+            widget.memory_usage_percent.draw(w, or_na(Query::utilization, [&] {
+                                                 return ftos<0>(widget.memory_usage.current_percentage()) + "%";
+                                             }));
+            widget.mem_usage.draw(w, or_na(Query::memory, [&] {
+                                      return width<5>(ftos<3>(widget.memv.draw(w))) + "/" +
+                                             ftos<0>(widget.d.memory_total) + "GB";
+                                  }));
 
             widget.temp.draw(w);
-            widget.temp_celsius.draw(w, ftos<0>(widget.temp.current_percentage()) + "℃");
-            widget.watts.draw(w, ftos<1>(widget.wattsv.draw()) + "W");
+            widget.temp_celsius.draw(
+                w, or_na(Query::temp, [&] { return ftos<0>(widget.temp.current_percentage()) + "℃"; }));
+            widget.watts.draw(
+                w, or_na(Query::power, [&] { return ftos<1>(widget.wattsv.draw(w)) + "W"; }));
 
             widget.fan.draw(w);
-            widget.fan_percent.draw(w, ftos<0>(widget.fan.current_percentage()) + "%");
+            widget.fan_percent.draw(
+                w, or_na(Query::fan, [&] { return ftos<0>(widget.fan.current_percentage()) + "%"; }));
             widget.list.draw(w);
-        }
-    }
+            widget.samples.draw(w);
 
-    [[nodiscard]] DynamicData get_data() const {
-        DynamicData data;
-        for (const auto &d : devices) {
-            data.push_back(d.probe_data());
+            if (widget.stale_count != 0) {
+                widget.stale.draw(w, "No answer x" + to_string(widget.stale_count));
+            } else {
+                widget.stale.draw(w, widget.failed.has(Query::processes) ? "Process list stale" : "");
+            }
+            if (tp >= widget.alert_until) {
+                widget.alert_text.clear();
+            }
+            widget.alert.draw(w, widget.alert_text);
         }
-        return data;
     }
+
+    void get_data(DynamicData &d) { prober->probe_all(now() + gpu_probe_deadline, d); }
     [[nodiscard]] Window create_window() {
-        Window w{":0.0", pos,
-                 Area<float>{circle_area.w * devices.size(), circle_area.h + theme::small_h * (max_procs + 1)}};
+        Window w{":0.0", pos, widget_area.scale({static_cast<float>(infos.size()), 1})};
 
         widgets = [&] {
             vector<Widget> temp;
-            for (auto [idx, d] : devices | enumerate) {
+            for (auto [idx, d] : infos | enumerate) {
                 const auto rpos{pos.stack_right({circle_area.scale({idx, 1})})};
-                temp.push_back(
-                    {w, d, rpos,
-                     Area<float>{circle_area.w * devices.size(), circle_area.h + proc_line.h * (max_procs + 1)}});
+                temp.push_back({w, d, rpos, widget_area.scale({static_cast<float>(infos.size()), 1})});
             }
             return temp;
         }();
@@ -221,6 +372,6 @@ class GPUWindow {
     Threads<GPU> t;
 
   public:
-    GPUWindow(atomic<bool> &run, Position<int> pos) : g{pos}, t{run, g} {}
+    GPUWindow(Scheduler &s, Position<int> pos) : g{pos}, t{s, g} {}
 };
 }; // namespace fprd
\ No newline at end of file
@@ -21,6 +21,8 @@ class System {
     struct DynamicData {
         time_t t;
     };
+    /// Nothing: everything comes from 'DynamicData'.
+    struct StaticData {};
     static inline const auto probe_interval{1s};
     static constexpr Area<float> area{256, 256};
 
@@ -36,6 +38,9 @@ class System {
           t_time{{&theme::normal, {0, 0}, theme::medium_area(area.w)},
                  theme::white,
                  theme::black} {}
+    System(Position<float> pos, StaticData /* s */) : System{pos} {}
+
+    [[nodiscard]] StaticData static_data() const { return {}; }
 
     void update_data(DynamicData d) { time = ctime(&d.t); }
 
@@ -45,11 +50,9 @@ class System {
         }
     }
 
-    DynamicData get_data() {
+    void get_data(DynamicData &d) {
         using namespace chrono;
-        DynamicData d;
         d.t = system_clock::to_time_t(system_clock::now());
-        return d;
     }
 
     Window create_window() {
@@ -65,6 +68,6 @@ class SystemWindow {
    public:
     static constexpr Area<float> area{System::area};
 
-    SystemWindow(atomic<bool> &run, Position<int> pos) : p{pos}, t{run, p} {}
+    SystemWindow(Scheduler &s, Position<int> pos) : p{pos}, t{s, p} {}
 };
 }  // namespace fprd
\ No newline at end of file
@@ -19,4 +19,13 @@ static inline const path resources{"@CMAKE_CURRENT_SOURCE_DIR@/res"};
 static inline const auto data_update_interval{1s}; // Update data every second
 static inline const auto fps{60};                  // Frames per second
 static inline const auto draw_interval{duration_cast<microseconds>(1s) / fps};
+static inline const auto frame_stats_interval{60s}; // Print the frame rate of each window. 0s for never.
+static inline const auto probe_threads{2U};         // Threads that run the probes of every window.
+static inline const auto cpu_probe_interval{250ms}; // Usage, frequencies, memory and temperature of the CPU.
+static inline const auto cpu_proc_interval{2s};     // The process list of the CPU panel. Rounded up to the above.
+static inline const auto proc_rescan_interval{10s}; // Full '/proc' scans when tracking processes from events
+static inline const auto proc_scan_threads{2U};     // Threads for scanning processes. They share RLIMIT_NOFILE.
+static inline const auto gpu_probe_threads{4U};     // Threads for probing GPUs. At most one per GPU.
+static inline const auto gpu_probe_deadline{300ms}; // GPUs that take longer keep showing their last data.
+static inline const auto gpu_alert_duration{10s};   // How long an alert from a GPU event stays on screen.
 } // namespace fprd
\ No newline at end of file
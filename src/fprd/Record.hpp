@@ -0,0 +1,227 @@
+/// @file Record.hpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <dbg/Log.hpp>
+#include <filesystem>
+#include <fprd/Config.hpp>
+#include <fprd/Threads.hpp>
+#include <fprd/Types.hpp>
+#include <fprd/Window.hpp>
+#include <fprd/util/Binary.hpp>
+#include <fprd/util/time.hpp>
+#include <fstream>
+#include <utility>
+
+namespace fprd {
+using namespace ::std;
+
+/// A drawable whose data can be recorded and replayed.
+/// 'StaticData' is what the widget needs from its probes besides 'DynamicData' (names, totals, ...). A widget
+/// constructed from it must not create any probes, so that recordings can be replayed on any machine.
+/// @tparam D
+template <class D>
+concept recordable = drawable<D> && requires(const D &d) {
+    { d.static_data() } -> convertible_to<typename D::StaticData>;
+} && constructible_from<D, Position<int>, typename D::StaticData>;
+
+/// The layout of a recording:
+/// - Header: 'magic', 'record_version' (u32) and the 'StaticData' of the widget.
+/// - Records until the end of the file: the time since the recording started (i64, ns) and the 'DynamicData'.
+/// Values are encoded by 'BinaryWriter', in the native byte order.
+/// 'record_version' changes once per released format, not with every change to a 'DynamicData'. Versions 1 to 7
+/// were used by development builds, and are not reused.
+constexpr array<char, 4> record_magic{'F', 'P', 'R', 'D'};
+constexpr uint32_t record_version{8};
+
+/// Wraps a drawable and writes everything that it probes to a file.
+/// @tparam D
+template <recordable D> class Recorder {
+    D &d;
+    ofstream file;
+    BinaryWriter out{file};
+    const time_point<high_resolution_clock> start{now()};
+
+  public:
+    using DynamicData = typename D::DynamicData;
+    static inline const auto probe_interval{D::probe_interval};
+
+    /// @param d
+    /// @param path Overwritten.
+    Recorder(D &d, const filesystem::path &path) : d{d}, file{path, ios::binary | ios::trunc} {
+        out.write(record_magic);
+        out.write(record_version);
+        out.write(d.static_data());
+        if (!out.good()) {
+            fatal_error("Failed to write " << path);
+        }
+    }
+    /// Copying is not allowed.
+    Recorder(const Recorder &) = delete;
+
+    void update_data(DynamicData &data) { d.update_data(data); }
+    void draw(Window &w, bool new_data) { d.draw(w, new_data); }
+    Window create_window() { return d.create_window(); }
+    bool has_news() { return fprd::has_news(d); }
+
+    void get_data(DynamicData &data) {
+        d.get_data(data);
+        out.write(static_cast<int64_t>(duration_cast<nanoseconds>(now() - start).count()));
+        out.write(data);
+        // Keep what we have if we crash, since that is when recordings are interesting.
+        file.flush();
+        if (!out.good()) {
+            dbg_out("Recording failed");
+        }
+    }
+};
+
+/// A drawable that shows a recording instead of probing.
+/// @tparam D
+template <recordable D> class Replay {
+    ifstream file;
+    BinaryReader in{file};
+    D d;
+    /// Shown again until the next record is due, and at the end of the recording.
+    typename D::DynamicData last{};
+    /// The next record, read ahead until it is due.
+    typename D::DynamicData next{};
+    /// When 'next' was recorded.
+    nanoseconds next_offset{0};
+    /// False at the end of the recording.
+    bool has_next{false};
+    /// When the first record was shown.
+    time_point<high_resolution_clock> start;
+    bool started{false};
+
+    /// @param path
+    /// @return typename D::StaticData
+    typename D::StaticData read_header(const filesystem::path &path) {
+        array<char, 4> magic{};
+        uint32_t version{0};
+        typename D::StaticData s;
+        if (!in.read(magic) || magic != record_magic || !in.read(version)) {
+            fatal_error("Not a recording: " << path);
+        }
+        if (version != record_version) {
+            fatal_error(path << " was recorded with version " << version << ", expected " << record_version);
+        }
+        if (!in.read(s)) {
+            fatal_error("Truncated recording: " << path);
+        }
+        return s;
+    }
+
+    /// @param data
+    /// @param offset When it was recorded.
+    /// @return bool False at the end of the recording.
+    bool read_record(typename D::DynamicData &data, nanoseconds &offset) {
+        int64_t ns;
+        if (!in.read(ns) || !in.read(data)) {
+            return false;
+        }
+        offset = nanoseconds{ns};
+        return true;
+    }
+
+  public:
+    using DynamicData = typename D::DynamicData;
+    static inline const auto probe_interval{D::probe_interval};
+
+    /// @param path
+    /// @param pos Of the window.
+    Replay(const filesystem::path &path, Position<int> pos)
+        : file{path, ios::binary}, d{pos, read_header(path)} {}
+    /// Copying is not allowed.
+    Replay(const Replay &) = delete;
+
+    void update_data(DynamicData &data) { d.update_data(data); }
+    void draw(Window &w, bool new_data) { d.draw(w, new_data); }
+    Window create_window() { return d.create_window(); }
+
+    /// Returns the records at the pace they were recorded (1x): the latest one that is due, and the last one until
+    /// the next is due and forever after the end. Never waits, since the worker that calls it is shared.
+    /// @param data
+    void get_data(DynamicData &data) {
+        if (!started) {
+            has_next = read_record(next, next_offset);
+            start = now() - next_offset;
+            started = true;
+        }
+        // A record that is due before the next call is shown now, rather than an interval late.
+        const auto until{now() + nanoseconds{D::probe_interval} / 2};
+        while (has_next && start + next_offset <= until) {
+            swap(last, next);
+            has_next = read_record(next, next_offset);
+        }
+        data = last;
+    }
+
+    /// Draw the whole recording as fast as possible, on the calling thread, and print how long it took.
+    /// Every record gets as many frames as it got live, from its offset in the recording, so that the animations
+    /// do the same work. No frame is skipped, unlike live, so this measures the cost of drawing every frame.
+    /// For profiling the drawing code.
+    /// @param running
+    void run_unpaced(atomic<bool> &running) {
+        auto w{d.create_window()};
+
+        size_t records{0};
+        size_t frames{0};
+        const auto tp{now()};
+        DynamicData data;
+        nanoseconds offset;
+        nanoseconds last_offset{0};
+        while (running && read_record(data, offset)) {
+            const auto interval{records == 0 ? nanoseconds{D::probe_interval} : offset - last_offset};
+            const auto frames_per_record{max<long>(interval / draw_interval, 1)};
+            last_offset = offset;
+            for (long frame{0}; frame < frames_per_record; frame++) {
+                if (frame == 0) {
+                    d.update_data(data);
+                }
+                w.progress = static_cast<float>(frame + 1) / static_cast<float>(frames_per_record);
+                w.steps = 0;
+                d.draw(w, frame == 0);
+                w.flush();
+                w.frame++;
+                frames++;
+            }
+            records++;
+        }
+        const auto ms{diff(tp)};
+        cerr << records << " records, " << frames << " frames in " << ms << "ms ("
+             << (frames == 0 ? 0.0 : static_cast<double>(ms) / static_cast<double>(frames)) << "ms per frame)"
+             << endl;
+    }
+};
+
+/// Shows a widget while recording its data.
+/// @tparam D
+template <recordable D> class RecordWindow {
+    D d;
+    Recorder<D> r;
+    Threads<Recorder<D>> t;
+
+  public:
+    RecordWindow(Scheduler &s, Position<int> pos, const filesystem::path &path) : d{pos}, r{d, path}, t{s, r} {}
+};
+
+/// Shows a recording at 1x.
+/// @tparam D
+template <recordable D> class ReplayWindow {
+    Replay<D> r;
+    Threads<Replay<D>> t;
+
+  public:
+    ReplayWindow(Scheduler &s, Position<int> pos, const filesystem::path &path) : r{path, pos}, t{s, r} {}
+};
+}; // namespace fprd
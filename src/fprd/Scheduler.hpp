@@ -0,0 +1,252 @@
+/// @file Scheduler.hpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+
+#pragma once
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <dbg/Log.hpp>
+#include <deque>
+#include <fprd/Config.hpp>
+#include <fprd/util/to_string.hpp>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fprd {
+using namespace ::std;
+using namespace ::std::chrono;
+
+/// Drives every window from one event loop.
+/// Probes run at their own periods on a few shared worker threads. The frames of all windows run together on the
+/// thread that calls 'run', at 'fps'. Each period is a timerfd, and 'run' sleeps in 'epoll_wait' until one of them
+/// expires, so the number of threads and wakeups does not grow with the number of windows.
+class Scheduler {
+    /// A periodic job for the workers.
+    struct Probe {
+        int timer;
+        function<void()> f;
+        bool busy{false}; // Queued or running. Ticks are skipped until it is done.
+    };
+
+    /// The epoll data of the frame timer. Probes use their index.
+    static constexpr uint64_t frame_id{numeric_limits<uint64_t>::max()};
+
+    atomic<bool> &running;
+    int epoll;
+    int frame_timer;
+    /// The probe of each window. Pointers stay valid while the vector grows.
+    vector<unique_ptr<Probe>> probes;
+    /// Draws a frame of a window, or skips it.
+    struct Frame {
+        function<bool()> f;
+        size_t drawn{0}; // Since the last 'report_frames'.
+    };
+
+    /// One per window.
+    vector<Frame> frames;
+    /// Frames since the last 'report_frames', drawn or not.
+    size_t frame_ticks{0};
+    /// Frames that were due while the loop was busy, and never ran, since the last 'report_frames'.
+    uint64_t late_frames{0};
+    time_point<steady_clock> last_report{steady_clock::now()};
+
+    const size_t threads;
+    mutex m;
+    condition_variable work;
+    /// Probes waiting for a worker.
+    deque<Probe *> queue;
+    bool stopping{false};
+
+    /// @param d
+    /// @return timespec
+    static timespec to_timespec(nanoseconds d) {
+        return {static_cast<time_t>(d.count() / 1'000'000'000), static_cast<long>(d.count() % 1'000'000'000)};
+    }
+
+    /// @param interval
+    /// @param id The epoll data.
+    /// @return int A timerfd in 'epoll' that expires right away, and then every 'interval'.
+    int add_timer(nanoseconds interval, uint64_t id) {
+        const auto fd{::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)};
+        // An initial expiration of 0 would disarm the timer.
+        const itimerspec spec{to_timespec(interval), to_timespec(1ns)};
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u64 = id;
+        if (fd < 0 || ::timerfd_settime(fd, 0, &spec, nullptr) != 0 ||
+            ::epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            fatal_error("Failed to add a timer: " << strerror(errno));
+        }
+        return fd;
+    }
+
+    /// @param fd A timerfd.
+    /// @return uint64_t How many times it expired since the previous call.
+    static uint64_t expirations(int fd) {
+        uint64_t n{0};
+        if (::read(fd, &n, sizeof(n)) != sizeof(n)) {
+            return 0;
+        }
+        return n;
+    }
+
+    /// Print how many frames each window drew, and how many were late, every 'frame_stats_interval'.
+    /// Without frame statistics, late frames are only told in debug builds, once a second at most.
+    void report_frames() {
+        const auto t{steady_clock::now()};
+        const duration<double> elapsed{t - last_report};
+        if (frame_stats_interval <= 0s) {
+            if (late_frames != 0 && elapsed >= 1s) {
+                dbg_out("Frames are late! Skipped " << late_frames << " in " << ftos<1>(elapsed.count()) << "s");
+                late_frames = 0;
+                last_report = t;
+            }
+            return;
+        }
+        if (elapsed < frame_stats_interval || frames.empty()) {
+            return;
+        }
+        cerr << "Frames per second:";
+        for (const auto &f : frames) {
+            cerr << ' ' << ftos<1>(static_cast<double>(f.drawn) / elapsed.count());
+        }
+        cerr << " (skipped";
+        for (auto &f : frames) {
+            cerr << ' ' << frame_ticks - f.drawn;
+            f.drawn = 0;
+        }
+        cerr << " of " << frame_ticks << ", " << late_frames << " late)" << endl;
+        frame_ticks = 0;
+        late_frames = 0;
+        last_report = t;
+    }
+
+    void work_loop() {
+        unique_lock lk{m};
+        while (true) {
+            work.wait(lk, [this] { return stopping || !queue.empty(); });
+            if (stopping) {
+                return;
+            }
+            auto *const p{queue.front()};
+            queue.pop_front();
+
+            lk.unlock();
+            p->f();
+            lk.lock();
+
+            p->busy = false;
+        }
+    }
+
+  public:
+    /// @param running 'run' returns when it is false.
+    /// @param threads For the probes.
+    Scheduler(atomic<bool> &running, size_t threads)
+        : running{running}, epoll{::epoll_create1(EPOLL_CLOEXEC)}, threads{max<size_t>(threads, 1)} {
+        if (epoll < 0) {
+            fatal_error("epoll_create1 failed: " << strerror(errno));
+        }
+        frame_timer = add_timer(draw_interval, frame_id);
+    }
+    /// Copying is not allowed.
+    Scheduler(const Scheduler &) = delete;
+
+    ~Scheduler() {
+        for (const auto &p : probes) {
+            ::close(p->timer);
+        }
+        ::close(frame_timer);
+        ::close(epoll);
+    }
+
+    /// Run 'f' on a worker every 'interval', starting right away. A tick is skipped while the previous run of 'f'
+    /// is still going.
+    /// @param interval
+    /// @param f
+    void every(nanoseconds interval, function<void()> f) {
+        auto &p{*probes.emplace_back(make_unique<Probe>())};
+        p.f = move(f);
+        p.timer = add_timer(interval, probes.size() - 1);
+    }
+
+    /// Run 'f' every frame, on the thread that calls 'run'.
+    /// @param f Returns false if it skipped drawing the frame.
+    void each_frame(function<bool()> f) { frames.push_back({move(f)}); }
+
+    /// Run everything until 'running' is false. Add everything before.
+    /// Frames that are late are skipped, rather than drawn back to back.
+    void run() {
+        vector<thread> workers;
+        for (size_t i{0}; i < min(threads, probes.size()); i++) {
+            workers.emplace_back([this] { work_loop(); });
+        }
+
+        array<epoll_event, 16> events;
+        while (running) {
+            const auto n{::epoll_wait(epoll, events.data(), events.size(), -1)};
+            if (n < 0) {
+                if (errno != EINTR) {
+                    dbg_out("epoll_wait failed: " << strerror(errno));
+                }
+                continue;
+            }
+            auto frame{false};
+            for (auto i{0}; i < n; i++) {
+                const auto id{events[i].data.u64};
+                if (id == frame_id) {
+                    // Printing every late frame would only make the next one later.
+                    if (const auto late{expirations(frame_timer)}; late > 1) {
+                        late_frames += late - 1;
+                    }
+                    frame = true;
+                    continue;
+                }
+                auto &p{*probes[id]};
+                expirations(p.timer);
+                lock_guard lg{m};
+                if (!p.busy) {
+                    p.busy = true;
+                    queue.push_back(&p);
+                    work.notify_one();
+                }
+            }
+            if (frame) {
+                for (auto &f : frames) {
+                    if (f.f()) {
+                        f.drawn++;
+                    }
+                }
+                frame_ticks++;
+                report_frames();
+            }
+        }
+
+        {
+            lock_guard lg{m};
+            stopping = true;
+        }
+        work.notify_all();
+        for (auto &w : workers) {
+            w.join();
+        }
+    }
+};
+}; // namespace fprd
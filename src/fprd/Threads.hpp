@@ -9,87 +9,115 @@
 #pragma once
 
 #include <chrono>
+#include <cmath>
 #include <dbg/Log.hpp>
 #include <fprd/Config.hpp>
+#include <fprd/Scheduler.hpp>
 #include <fprd/Types.hpp>
 #include <fprd/Window.hpp>
+#include <fprd/util/Allocations.hpp>
+#include <fprd/util/Progress.hpp>
+#include <fprd/util/TripleBuffer.hpp>
 #include <fprd/util/time.hpp>
-#include <functional>
-#include <mutex>
-#include <queue>
-#include <thread>
+#include <optional>
 
 namespace fprd {
 using namespace ::std;
 
 /// The definition of a drawable type in fprd.
+/// 'get_data' overwrites a 'DynamicData' that it got before, so that it can reuse its memory. 'update_data' may
+/// swap what it keeps out of its 'DynamicData' instead of copying it, since nothing reads that data again.
+/// 'probe_interval' is any duration.
 /// @tparam D
 template <class D>
-concept drawable = requires(D &d, Window &w, const typename D::DynamicData &data) {
+concept drawable = requires(D &d, Window &w, typename D::DynamicData &data, typename D::DynamicData &out) {
     { d.update_data(data) } -> same_as<void>;
     { d.draw(w, declval<bool>()) } -> same_as<void>;
-    { d.get_data() } -> same_as<typename D::DynamicData>;
+    { d.get_data(out) } -> same_as<void>;
     { d.create_window() } -> same_as<Window>;
 }
-&&is_same_v<decltype(D::probe_interval), const seconds>;
+&&convertible_to<decltype(D::probe_interval), nanoseconds>;
 
+/// A drawable can also have 'has_news', which is true when it has something to show before its next data, like an
+/// alert. It is called before each frame, on the thread that draws.
+/// @param d
+/// @return bool
+template <drawable D> bool has_news(D &d) {
+    if constexpr (requires {
+                      { d.has_news() } -> same_as<bool>;
+                  }) {
+        return d.has_news();
+    } else {
+        return false;
+    }
+}
+
+/// The data and the frames of a window, driven by a 'Scheduler'.
+/// The probe publishes to 'buf' on a worker every 'probe_interval', and the next frame takes it from there.
+/// Neither side waits for the other, however long a probe or an 'update_data' takes.
+/// @tparam D
 template <drawable D> class Threads {
     using DynamicData = typename D::DynamicData;
 
-    mutex m;         /// Mutex for our buffer.
-    DynamicData buf; /// Data buffer.
+    D &d;
 
-    /// The thread for fetching new data.
-    thread data;
-    /// The thread for draw calls to X11.
-    thread draw;
+    /// Data buffer.
+    TripleBuffer<DynamicData> buf;
 
-  public:
-    Threads(atomic<bool> &running, D &d)
-        : m{}, data{[&running, &mtx = this->m, &buf = this->buf, interval = D::probe_interval, &d] {
-              while (running) {
-                  const auto tp{now() + interval};
-                  const auto data{d.get_data()};
-                  {
-                      lock_guard lg{mtx};
-                      buf = data;
-                  }
-                  this_thread::sleep_until(tp);
-              }
-          }},
-          draw{[&running, &d, &buf = this->buf, &mtx = this->m] {
-              auto w{d.create_window()};
+    /// Created by the first frame, on the thread that draws.
+    optional<Window> w;
+    /// Of the animations towards the latest data.
+    Progress progress;
+    /// 'floor(progress * steps)' when the last frame was drawn. Frames with the same value would look the same.
+    float drawn_step{0};
 
-              /// Frame counter.
-              unsigned char frame_counter{0};
+    /// Skips the frames that would look the same as the last one, so an idle window draws once per data.
+    /// @return bool True if the frame was drawn.
+    bool frame() {
+        const auto first{!w};
+        if (first) {
+            w.emplace(d.create_window());
+        }
 
-              while (running) {
-                  const auto tp{now() + draw_interval};
+        const auto has_new_data{buf.take()};
+        if (has_new_data) {
+            progress.restart(w->frame);
+        }
+        if (has_new_data || first) {
+            // The first frame draws the empty data, until the first probe is done.
+            d.update_data(buf.front_buffer());
+        }
 
-                  const auto has_new_data{frame_counter == 0};
-                  if (has_new_data) {
-                      /// Attempt to obtain new data.
-                      lock_guard lg{mtx};
-                      d.update_data(buf);
-                  }
-
-                  w.frame_counter = frame_counter;
-                  d.draw(w, has_new_data);
-                  w.flush();
-
-                  if (now() >= tp) {
-                      cerr << "Frame is late by " << duration_cast<milliseconds>(now() - tp).count() << "ms!"
-                           << endl;
-                  }
-                  this_thread::sleep_until(tp);
-                  frame_counter++;
-                  frame_counter %= fps * duration_cast<seconds>(D::probe_interval).count();
-              }
-          }} {}
+        const auto p{progress.at(w->frame)};
+        const auto drawn{first || has_new_data || has_news(d) || w->frame >= w->redraw_at ||
+                         floor(p * w->steps) != drawn_step};
+        if (drawn) {
+            w->progress = p;
+            w->steps = 0;
+            w->redraw_at = UINT64_MAX;
+            d.draw(*w, has_new_data || first);
+            w->flush();
+            drawn_step = floor(p * w->steps);
+        }
+        w->frame++;
+        return drawn;
+    }
 
-    ~Threads() {
-        draw.join();
-        data.join();
+  public:
+    /// @param s Must outlive this, and must not be running yet.
+    /// @param d
+    Threads(Scheduler &s, D &d) : d{d} {
+        s.every(D::probe_interval, [this] {
+            const auto allocations{allocation_count()};
+            this->d.get_data(buf.back_buffer());
+            buf.publish();
+            if (const auto n{allocation_count() - allocations}; n != 0) {
+                cerr << "Probe allocated " << n << " times" << endl;
+            }
+        });
+        s.each_frame([this] { return frame(); });
     }
+    /// Copying is not allowed.
+    Threads(const Threads &) = delete;
 };
 }; // namespace fprd
\ No newline at end of file
@@ -8,6 +8,9 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <fprd/Theme.hpp>
 #include <fprd/wrapper/Cairo.hpp>
 #include <fprd/wrapper/Xlib.hpp>
@@ -34,7 +37,29 @@ class Window : public cairo::Surface {
     /// The base flush function should be private.
     using Base::flush;
 
-    unsigned char frame_counter;
+    /// Counts every frame since the window was created, including the ones that are not drawn.
+    uint64_t frame{0};
+    /// How far the animations are from the previous data to the latest, from 0 to 1.
+    float progress{1};
+    /// How many frames that look different the animations need from the previous data to the latest, e.g. one
+    /// per pixel that a bar grows. Reset before each frame and raised with 'animate'. 0 if nothing moves.
+    float steps{0};
+
+    /// The next frame that looks different because of an animation with its own pace, instead of 'progress'.
+    /// Reset before each frame. The maximum if there is none.
+    uint64_t redraw_at{UINT64_MAX};
+
+    /// Called by the animations while drawing.
+    /// @param n Frames that look different, over the whole animation.
+    void animate(float n) {
+        if (n > 0) {
+            steps = max(steps, ceil(n));
+        }
+    }
+
+    /// Called while drawing by the animations with their own pace (see 'AnimatedList'), while they are not done.
+    /// @param f The next frame that looks different. It is drawn, even if 'progress' and 'steps' say otherwise.
+    void keep_drawing(uint64_t f) { redraw_at = min(redraw_at, f); }
 
     /// Create a new window.
     /// @param x11
@@ -25,8 +25,9 @@ class AnimatedBar : public Bar<o, d, Frame, Empty, Filled> {
     using Base = Bar<o, d, Frame, Empty, Filled>;
     using Base::draw;
 
-    float current{0};   // The currently drawn percentage.
-    float increment{0}; // The increment per draw call.
+    float current{0}; // The currently drawn percentage.
+    float from{0};    // The percentage at the last update.
+    float target{0};  // The percentage at the end of the animation.
 
   public:
     /// Default constructor.
@@ -39,18 +40,20 @@ class AnimatedBar : public Bar<o, d, Frame, Empty, Filled> {
     /// @param b
     AnimatedBar(Base b) : Base{b} {};
 
-    /// Update the target percentage.
-    /// Currently hard-coded such that this function must be called every second
-    /// or it breaks.
-    /// TODO: Make the update interval adjustable via template parameters.
+    /// Update the target percentage. The bar moves there from where it is until the next update.
     /// @param target_percentage
-    void update(float target_percentage) { increment = (target_percentage - current) / fps; }
+    void update(float target_percentage) {
+        from = current;
+        target = target_percentage;
+    }
 
     /// Call this every frame.
     /// @param w
     void draw(Window &w) {
+        const auto length{o == Orientation::vertical ? this->area.h : this->area.w};
+        w.animate(abs(target - from) / 100 * length);
+        current = from + (target - from) * w.progress;
         Base::draw(w, current);
-        current += increment;
     }
 
     /// In case you need to peek the current value of the bar.
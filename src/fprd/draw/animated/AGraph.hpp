@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <fprd/Config.hpp>
 #include <fprd/draw/Graph.hpp>
 
@@ -44,6 +45,11 @@ class AnimatedGraph : public Graph<size, Border, FG, BG> {
             return data;
         }
 
+        /// @return bool True if every value is the same, so that scrolling does not show.
+        [[nodiscard]] bool flat() const {
+            return all_of(history.begin(), history.end(), [this](float d) { return d == history[0]; });
+        }
+
         /// Add new data to the history.
         /// @param d
         void add(float d) {
@@ -67,10 +73,7 @@ class AnimatedGraph : public Graph<size, Border, FG, BG> {
     /// Moving is allowed, however.
     AnimatedGraph(AnimatedGraph &&) noexcept = default;
 
-    /// Update the target percentage.
-    /// Currently hard-coded such that this function must be called every second
-    /// or it breaks.
-    /// TODO: Make the update interval adjustable via template parameters.
+    /// Add a value. The graph scrolls to it until the next update.
     /// @param new_value
     void update(float new_value) {
         if (100 < new_value) {
@@ -87,6 +90,12 @@ class AnimatedGraph : public Graph<size, Border, FG, BG> {
 
     /// Call this every frame.
     /// @param w
-    void draw(Window &w) { Base::draw(w, (float)w.frame_counter / fps, current.get()); }
+    void draw(Window &w) {
+        if (!current.flat()) {
+            // Scrolls by one value.
+            w.animate(this->area.w / (size - 2));
+        }
+        Base::draw(w, w.progress, current.get());
+    }
 };
 }; // namespace fprd
\ No newline at end of file
@@ -0,0 +1,98 @@
+/// @file ASampleGraph.hpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fprd/Config.hpp>
+#include <fprd/draw/Graph.hpp>
+#include <span>
+
+namespace fprd {
+using namespace std;
+
+/// Animated line graph that gets many samples per update, e.g. everything a driver sampled during the last second.
+/// Each update scrolls the graph by the number of new samples, smoothly until the next update.
+/// @tparam size The number of samples shown.
+/// @tparam Border
+/// @tparam FG
+/// @tparam BG
+template <short size, cairo::source Border = Color, cairo::source FG = Color, cairo::source BG = Color>
+class AnimatedSampleGraph : public Graph<size, Border, FG, BG> {
+    using Base = Graph<size, Border, FG, BG>;
+
+    /// Newest first. Twice the size, so that the samples that are scrolled out are still there to draw.
+    array<float, size * 2> history{};
+    /// Samples added by the last update. They scroll in until the next one.
+    short pending{0};
+
+    /// @param i Fractional index into 'history'.
+    /// @return float
+    [[nodiscard]] float at(float i) const {
+        const auto j{static_cast<size_t>(i)};
+        if (j + 1 >= history.size()) {
+            return history.back();
+        }
+        return lerp(history[j], history[j + 1], i - static_cast<float>(j));
+    }
+
+  public:
+    /// Initialize from a Graph.
+    /// @param graph
+    AnimatedSampleGraph(Base graph) : Base{graph} {};
+    /// Copying is not allowed.
+    AnimatedSampleGraph(const AnimatedSampleGraph &) = delete;
+    /// Moving is allowed, however.
+    AnimatedSampleGraph(AnimatedSampleGraph &&) noexcept = default;
+
+    /// Add new samples. The graph scrolls to them until the next update.
+    /// @param samples In %, oldest first. Only the newest 'size' are kept.
+    void update(span<const float> samples) {
+        const auto n{static_cast<short>(min<size_t>(samples.size(), size))};
+        shift_right(history.begin(), history.end(), n);
+        for (short i{0}; i < n; i++) {
+            history[i] = clamp(samples[samples.size() - 1 - i], 0.0F, 100.0F);
+        }
+        pending = n;
+    }
+
+    /// Call this every frame.
+    /// @param w
+    void draw(Window &w) {
+        // How many samples are still hidden beyond the right edge.
+        const auto shift{static_cast<float>(pending) * (1 - w.progress)};
+        const auto interval{this->area.w / (size - 1)};
+        if (const auto shown{history.begin() + size + pending};
+            any_of(history.begin(), shown, [&](float d) { return d != history[0]; })) {
+            w.animate(static_cast<float>(pending) * interval);
+        }
+        const auto y{[this](float d) { return this->area.h * (100 - d) / 100; }};
+
+        w.set_source(this->bg);
+        w.rectangle(this->pos, this->area);
+        w.fill();
+
+        w.set_source(this->fg);
+        w.move_to(this->pos.offset({this->area.w, y(at(shift))}));
+        for (auto i{static_cast<short>(ceil(shift))}; i < shift + size - 1; i++) {
+            w.line_to(this->pos.offset({this->area.w - (i - shift) * interval, y(history[i])}));
+        }
+        w.line_to(this->pos.offset({0, y(at(shift + size - 1))}));
+        w.line_to(this->pos.offset({0, this->area.h}));
+        w.line_to(this->pos.offset({this->area.w, this->area.h}));
+        w.fill();
+
+        w.set_source(this->b);
+        w.set_line_width(this->border_width);
+        w.rectangle(this->pos, this->area);
+        w.stroke();
+    }
+};
+}; // namespace fprd
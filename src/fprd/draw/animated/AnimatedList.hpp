@@ -9,8 +9,10 @@
 #pragma once
 
 #include <fprd/draw/Text.hpp>
+#include <fprd/util/Progress.hpp>
 #include <fprd/util/ranges.hpp>
 #include <functional>
+#include <utility>
 
 namespace fprd {
 
@@ -31,7 +33,7 @@ concept list_item = requires(const T &t) {
 template <list_item Item, size_t max_items> class AnimatedList {
     using Data = vector<Item>;
 
-    /// Used to create the animation for the next second.
+    /// Used to create the animation until the next update.
     struct Diff {
         struct Movement {
             size_t new_idx;
@@ -47,8 +49,9 @@ template <list_item Item, size_t max_items> class AnimatedList {
     struct ItemText {
         Text<VerticalAlign::left> drawer; // Drawn text object.
         string text;                      // The shown text.
-        float vertical_motion;            // The vertical movement per frame.
-        float fading;                     // Negative means deleted in the next update.
+        float start_y;                    // Where the animation starts.
+        float end_y;                      // Where the animation ends.
+        float fading;                     // Positive fades in. Negative fades out, and is deleted next update.
     };
 
     /// Template text for list items.
@@ -62,6 +65,10 @@ template <list_item Item, size_t max_items> class AnimatedList {
     vector<ItemText> items;
     /// Recored to generate the animation.
     Data prev;
+    /// The list may be updated less often than the rest of the window, so it keeps its own pace.
+    Progress progress;
+    /// The progress is restarted by the next frame, which knows its number.
+    bool updated{false};
 
   public:
     /// Constructor. The window is needed to draw the header.
@@ -86,12 +93,9 @@ template <list_item Item, size_t max_items> class AnimatedList {
     /// Moving is allowed, however.
     AnimatedList(AnimatedList &&) noexcept = default;
 
-    /// Update the target percentage.
-    /// Currently hard-coded such that this function must be called every second
-    /// or it breaks.
-    /// TODO: Make the update interval adjustable via template parameters.
-    /// @param new_data
-    void update(const Data &new_data) {
+    /// Update the items. The animation runs until the next update.
+    /// @param new_data Swapped with the previous data, which saves copying the items. Its memory can be reused.
+    void update(Data &new_data) {
         if (new_data.size() > max_items) {
             fatal_error("New data larger than expected: " << new_data.size() << " (Expected: " << max_items
                                                           << ")");
@@ -103,16 +107,17 @@ template <list_item Item, size_t max_items> class AnimatedList {
         // Re-create the animation from the diff.
         const auto d{diff(new_data, prev)};
         for (auto i : d.appeared) {
-            items.push_back(create_text_item(new_data.at(i), max_items, i, 1.0F / fps));
+            items.push_back(create_text_item(new_data.at(i), max_items, i, 1));
         }
         for (auto i : d.disappeared) {
-            items.push_back(create_text_item(prev.at(i), i, max_items, -1.0F / fps));
+            items.push_back(create_text_item(prev.at(i), i, max_items, -1));
         }
         for (auto [e, s] : d.moved) {
             items.push_back(create_text_item(new_data.at(e), s, e, 0));
         }
 
-        prev = new_data;
+        swap(prev, new_data);
+        updated = true;
     }
 
     /// Call this every frame.
@@ -122,11 +127,25 @@ template <list_item Item, size_t max_items> class AnimatedList {
         w.set_source(theme::black);
         w.fill();
 
+        if (updated) {
+            progress.restart(w.frame);
+            updated = false;
+        }
+        const auto p{progress.at(w.frame)};
+        // The window may be done with its own animations before this one, so the frames are asked for here.
+        float steps{0};
         for (auto &i : items) {
-            i.drawer.pos.y += i.vertical_motion;
-            i.drawer.fg.a += i.fading;
+            steps = max(steps, ceil(abs(i.end_y - i.start_y)));
+            i.drawer.pos.y = i.start_y + (i.end_y - i.start_y) * p;
+            if (i.fading != 0) {
+                i.drawer.fg.a = item_template.fg.a * (i.fading > 0 ? p : 1 - p);
+            }
             i.drawer.draw(w, i.text);
         }
+        if (p < 1 && steps > 0) {
+            // The next pixel that the items move.
+            w.keep_drawing(progress.frame_at((floor(p * steps) + 1) / steps));
+        }
     }
 
   private:
@@ -182,8 +201,8 @@ template <list_item Item, size_t max_items> class AnimatedList {
             copy.fg.a = 0;
         }
 
-        return {copy, oss.str(),
-                (static_cast<float>(end_pos) - static_cast<float>(start_pos)) * item_template.area.h / fps, fade};
+        const auto end_y{pos.y + item_template.area.h * static_cast<float>(end_pos + 1)};
+        return {copy, oss.str(), copy.pos.y, end_y, fade};
     }
 };
 }; // namespace fprd
\ No newline at end of file
@@ -0,0 +1,747 @@
+/// @file NVML.cpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+///
+/// A stand-in for 'libnvidia-ml.so.1' that plays a scripted scenario, for running the GPU window on machines
+/// without an NVIDIA GPU. It implements the part of the API that 'nvml::Device' uses.
+/// Built as 'libnvidia-ml.so.1' with '-DFPRD_FAKE_NVML=ON'. A normal build can use it with 'LD_LIBRARY_PATH' too.
+///
+/// The scenario is read on 'nvmlInit' from the file in the environment variable 'FPRD_NVML_SCENARIO' (a single
+/// fake GPU if unset). One command per line, '#' starts a comment:
+///
+///     device <memory MiB> <name...>
+///         Add a device. The commands below apply to the last device.
+///     curve <field> <period s> <value>...
+///         'field' over time: evenly spaced points over 'period', interpolated linearly, repeated forever.
+///         Repeat the first value at the end for a smooth loop. Fields and units:
+///         gpu (%), memory (%), memory_used (MiB), fan (%), temp (C), power (W), clock (MHz)
+///     process <pid> <memory MiB> [<from s> [<until s>]]
+///         A graphics process using the device between 'from' and 'until' (forever by default).
+///     compute <pid> <memory MiB> [<from s> [<until s>]]
+///         The same for a compute process. A PID can be both.
+///     event <type> <every s> [<data>]
+///         An event every 'every' seconds. Types: xid (with the XID in 'data'), clock, pstate.
+///     throttle <reasons>
+///         The clock throttle reasons (a bit mask of 'nvmlClocksThrottleReason*') that the device reports.
+///     fail <call> <error> [<every>]
+///         Make every 'every'-th call fail (every call by default). 'call' is the name of the function without the
+///         'nvml' or 'nvmlDevice' prefix and version suffix, e.g. 'GetFanSpeed'. 'error' is the name of the error
+///         without the 'NVML_ERROR_' prefix, e.g. 'NOT_SUPPORTED'.
+///         'Init' and 'GetCount' fail before the first device.
+///     latency <call> <ms>
+///         Make a call slow.
+///
+/// The device is in P0 while the 'gpu' curve is above 50%, else in P8.
+/// 'GetSamples' samples the 'gpu' curve 6 times a second, like the driver does. 'GetProcessUtilization' splits the
+/// newest of those samples evenly between the running processes.
+/// Time starts at 'nvmlInit'.
+
+#include <nvml.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <dbg/Log.hpp>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace fprd {
+using namespace ::std;
+using namespace ::std::chrono;
+
+namespace fake {
+
+/// Used when 'FPRD_NVML_SCENARIO' is not set.
+constexpr string_view default_scenario{R"(
+device 8192 FPRD Fake GPU
+curve gpu 20 0 30 100 100 10 0
+curve memory 20 0 20 60 40 0
+curve memory_used 60 500 4000 6000 500
+curve fan 60 30 60 30
+curve temp 60 40 75 40
+curve power 20 20 180 250 30 20
+curve clock 20 300 1800 1900 300
+process 1 1200
+)"};
+
+/// A value that changes over time.
+struct Curve {
+    double period{1};            // Seconds.
+    vector<double> points{0.0}; // Evenly spaced over 'period'.
+
+    /// @param t Seconds.
+    /// @return double
+    [[nodiscard]] double at(double t) const {
+        if (points.size() == 1) {
+            return points.front();
+        }
+        const auto x{fmod(t, period) / period * static_cast<double>(points.size() - 1)};
+        const auto i{min(static_cast<size_t>(x), points.size() - 2)};
+        return lerp(points[i], points[i + 1], x - static_cast<double>(i));
+    }
+};
+
+/// What can be scripted with 'curve'.
+enum Field : u_char { gpu, memory, memory_used, fan, temp, power, clock, field_count };
+constexpr array<string_view, field_count> field_names{"gpu", "memory", "memory_used", "fan",
+                                                      "temp", "power",  "clock"};
+
+/// A process using a device.
+struct Process {
+    uint pid;
+    ulong memory; // MiB
+    double from;  // Seconds.
+    double until; // Seconds.
+    bool compute; // Else graphics.
+
+    /// @param t Seconds.
+    /// @return bool
+    [[nodiscard]] bool running(double t) const { return from <= t && t < until; }
+};
+
+/// Scripted by 'event'.
+struct Event {
+    unsigned long long type;
+    double every; // Seconds.
+    unsigned long long data;
+};
+
+/// For parsing 'event'.
+constexpr array<pair<string_view, unsigned long long>, 3> event_names{{
+    {"xid", nvmlEventTypeXidCriticalError},
+    {"clock", nvmlEventTypeClock},
+    {"pstate", nvmlEventTypePState},
+}};
+
+/// What happens when a function is called.
+struct Fault {
+    nvmlReturn_t error{NVML_SUCCESS};
+    uint every{1}; // Fail every n-th call.
+    milliseconds latency{0};
+    uint calls{0};
+};
+
+/// By the name of the call, e.g. 'GetFanSpeed'.
+using Faults = map<string, Fault, less<>>;
+
+/// How often the driver samples utilization, and how many samples it keeps.
+constexpr auto sample_period{microseconds{1s} / 6};
+constexpr auto sample_buffer{120};
+
+/// For parsing 'fail'.
+constexpr array<pair<string_view, nvmlReturn_t>, 9> error_names{{
+    {"UNINITIALIZED", NVML_ERROR_UNINITIALIZED},
+    {"INVALID_ARGUMENT", NVML_ERROR_INVALID_ARGUMENT},
+    {"NOT_SUPPORTED", NVML_ERROR_NOT_SUPPORTED},
+    {"NO_PERMISSION", NVML_ERROR_NO_PERMISSION},
+    {"NOT_FOUND", NVML_ERROR_NOT_FOUND},
+    {"INSUFFICIENT_SIZE", NVML_ERROR_INSUFFICIENT_SIZE},
+    {"TIMEOUT", NVML_ERROR_TIMEOUT},
+    {"GPU_IS_LOST", NVML_ERROR_GPU_IS_LOST},
+    {"UNKNOWN", NVML_ERROR_UNKNOWN},
+}};
+}; // namespace fake
+}; // namespace fprd
+
+/// A fake device. 'nvmlDevice_t' points to this.
+struct nvmlDevice_st {
+    std::string name;
+    unsigned long memory_total; // MiB
+    std::array<fprd::fake::Curve, fprd::fake::field_count> curves;
+    std::vector<fprd::fake::Process> procs;
+    std::vector<fprd::fake::Event> events;
+    unsigned long long throttle{0};
+    fprd::fake::Faults faults;
+};
+
+/// The events that a set waits for. 'nvmlEventSet_t' points to this.
+struct nvmlEventSet_st {
+    /// A scripted event of a registered device.
+    struct Pending {
+        nvmlDevice_t device;
+        fprd::fake::Event e;
+        double next; // Seconds.
+    };
+    std::vector<Pending> pending;
+};
+
+namespace fprd {
+namespace fake {
+
+/// The state of the library.
+struct Scenario {
+    /// For the calls that are not about a device.
+    Faults faults;
+    /// Never shrinks, so that handles stay valid.
+    vector<unique_ptr<nvmlDevice_st>> devices;
+    time_point<steady_clock> start;
+    /// 'nvmlInit' calls minus 'nvmlShutdown' calls.
+    uint inits{0};
+    /// For the fault counters. Calls may come from many threads.
+    mutex m;
+
+    /// @param is
+    /// @param source For error messages.
+    void load(istream &is, string_view source) {
+        Faults *faults_of_last{&faults};
+        nvmlDevice_st *last{nullptr};
+        string line;
+        for (auto line_no{1}; getline(is, line); line_no++) {
+            line = line.substr(0, line.find('#'));
+            istringstream ls{line};
+            string command;
+            if (!(ls >> command)) {
+                continue;
+            }
+            const auto bad{[&](string_view what) {
+                fatal_error("NVML scenario " << source << ":" << line_no << ": " << what);
+            }};
+
+            if (command == "device") {
+                auto &d{*devices.emplace_back(make_unique<nvmlDevice_st>())};
+                ls >> d.memory_total >> ws;
+                getline(ls, d.name);
+                if (d.name.empty()) {
+                    bad("expected 'device <memory MiB> <name...>'");
+                }
+                last = &d;
+                faults_of_last = &d.faults;
+            } else if (command == "curve" || command == "process" || command == "compute" || command == "event" ||
+                       command == "throttle") {
+                if (last == nullptr) {
+                    bad("'" + command + "' before the first 'device'");
+                }
+                if (command == "curve") {
+                    string field;
+                    Curve c;
+                    c.points.clear();
+                    ls >> field >> c.period;
+                    const auto f{find(field_names.begin(), field_names.end(), field)};
+                    for (double v; ls >> v;) {
+                        c.points.push_back(v);
+                    }
+                    if (f == field_names.end() || c.period <= 0 || c.points.empty()) {
+                        bad("expected 'curve <field> <period s> <value>...'");
+                    }
+                    last->curves[f - field_names.begin()] = move(c);
+                } else if (command == "event") {
+                    string type;
+                    Event e{0, 0, 0};
+                    ls >> type >> e.every;
+                    const auto t{find_if(event_names.begin(), event_names.end(),
+                                         [&](const auto &n) { return n.first == type; })};
+                    if (t == event_names.end() || e.every <= 0) {
+                        bad("expected 'event <type> <every s> [<data>]'");
+                    }
+                    e.type = t->second;
+                    if (unsigned long long data; ls >> data) {
+                        e.data = data;
+                    }
+                    last->events.push_back(e);
+                } else if (command == "throttle") {
+                    if (!(ls >> last->throttle)) {
+                        bad("expected 'throttle <reasons>'");
+                    }
+                } else {
+                    Process p{0, 0, 0, HUGE_VAL, command == "compute"};
+                    if (!(ls >> p.pid >> p.memory)) {
+                        bad("expected '" + command + " <pid> <memory MiB> [<from s> [<until s>]]'");
+                    }
+                    // A failed read would overwrite the defaults.
+                    if (double from; ls >> from) {
+                        p.from = from;
+                        if (double until; ls >> until) {
+                            p.until = until;
+                        }
+                    }
+                    last->procs.push_back(p);
+                }
+            } else if (command == "fail") {
+                string call;
+                string error;
+                ls >> call >> error;
+                const auto e{find_if(error_names.begin(), error_names.end(),
+                                     [&](const auto &n) { return n.first == error; })};
+                if (call.empty() || e == error_names.end()) {
+                    bad("expected 'fail <call> <error> [<every>]'");
+                }
+                auto &f{(*faults_of_last)[call]};
+                f.error = e->second;
+                if (uint every; ls >> every && every > 0) {
+                    f.every = every;
+                }
+            } else if (command == "latency") {
+                string call;
+                long ms{0};
+                if (!(ls >> call >> ms)) {
+                    bad("expected 'latency <call> <ms>'");
+                }
+                (*faults_of_last)[call].latency = milliseconds{ms};
+            } else {
+                bad("unknown command '" + command + "'");
+            }
+        }
+    }
+
+    /// Load the scenario of 'FPRD_NVML_SCENARIO', and start the clock.
+    void load() {
+        if (const auto *const path{getenv("FPRD_NVML_SCENARIO")}; path != nullptr) {
+            ifstream f{path};
+            if (!f) {
+                fatal_error("Failed to open NVML scenario " << path);
+            }
+            load(f, path);
+        } else {
+            istringstream is{string{default_scenario}};
+            load(is, "<default>");
+        }
+        start = steady_clock::now();
+    }
+
+    /// @return double Seconds since 'nvmlInit'.
+    [[nodiscard]] double time() const { return duration<double>(steady_clock::now() - start).count(); }
+
+    /// Play the scripted faults of a call.
+    /// @param faults
+    /// @param call
+    /// @return nvmlReturn_t
+    nvmlReturn_t inject(Faults &faults, string_view call) {
+        const auto f{faults.find(call)};
+        if (f == faults.end()) {
+            return NVML_SUCCESS;
+        }
+        this_thread::sleep_for(f->second.latency);
+        lock_guard lg{m};
+        return ++f->second.calls % f->second.every == 0 ? f->second.error : NVML_SUCCESS;
+    }
+
+    /// Common checks of the calls about a device.
+    /// @param d
+    /// @param call
+    /// @return nvmlReturn_t
+    nvmlReturn_t enter(nvmlDevice_t d, string_view call) {
+        if (inits == 0) {
+            return NVML_ERROR_UNINITIALIZED;
+        }
+        if (d == nullptr) {
+            return NVML_ERROR_INVALID_ARGUMENT;
+        }
+        return inject(d->faults, call);
+    }
+
+    /// The running processes of a kind, like the 'Get*RunningProcesses' calls.
+    /// @param d
+    /// @param compute
+    /// @param count
+    /// @param infos
+    /// @return nvmlReturn_t
+    nvmlReturn_t processes(nvmlDevice_t d, bool compute, unsigned int *count, nvmlProcessInfo_t *infos) const {
+        const auto t{time()};
+        unsigned int n{0};
+        for (const auto &p : d->procs) {
+            if (p.compute == compute && p.running(t)) {
+                if (n < *count) {
+                    infos[n] = {};
+                    infos[n].pid = p.pid;
+                    infos[n].usedGpuMemory = p.memory << 20U;
+                }
+                n++;
+            }
+        }
+        const auto fits{n <= *count};
+        *count = n;
+        return fits ? NVML_SUCCESS : NVML_ERROR_INSUFFICIENT_SIZE;
+    }
+
+    /// @param d
+    /// @param f
+    /// @return double The current value of a curve.
+    [[nodiscard]] double value(nvmlDevice_t d, Field f) const { return d->curves[f].at(time()); }
+
+    /// @param d
+    /// @param f
+    /// @param scale
+    /// @return unsigned int The current value of a curve times 'scale', rounded to a non-negative integer.
+    [[nodiscard]] unsigned int rounded(nvmlDevice_t d, Field f, double scale = 1) const {
+        return static_cast<unsigned int>(max(lround(value(d, f) * scale), 0L));
+    }
+
+    /// @param d
+    /// @param f
+    /// @return unsigned int The current value of a percentage curve.
+    [[nodiscard]] unsigned int percent(nvmlDevice_t d, Field f) const {
+        return static_cast<unsigned int>(clamp(lround(value(d, f)), 0L, 100L));
+    }
+};
+
+/// @return Scenario&
+Scenario &scenario() {
+    static Scenario s;
+    return s;
+}
+}; // namespace fake
+}; // namespace fprd
+
+using fprd::fake::scenario;
+namespace fake = fprd::fake;
+
+const char *nvmlErrorString(nvmlReturn_t result) {
+    if (result == NVML_SUCCESS) {
+        return "Success";
+    }
+    for (const auto &[name, e] : fake::error_names) {
+        if (e == result) {
+            return name.data();
+        }
+    }
+    return "Unknown Error";
+}
+
+nvmlReturn_t nvmlInit_v2() {
+    auto &s{scenario()};
+    if (s.inits == 0 && s.devices.empty()) {
+        s.load();
+    }
+    if (const auto r{s.inject(s.faults, "Init")}; r != NVML_SUCCESS) {
+        return r;
+    }
+    s.inits++;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlShutdown() {
+    auto &s{scenario()};
+    if (s.inits == 0) {
+        return NVML_ERROR_UNINITIALIZED;
+    }
+    s.inits--;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetCount(unsigned int *deviceCount) {
+    auto &s{scenario()};
+    if (s.inits == 0) {
+        return NVML_ERROR_UNINITIALIZED;
+    }
+    if (const auto r{s.inject(s.faults, "GetCount")}; r != NVML_SUCCESS) {
+        return r;
+    }
+    *deviceCount = s.devices.size();
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetHandleByIndex_v2(unsigned int index, nvmlDevice_t *device) {
+    auto &s{scenario()};
+    if (s.inits == 0) {
+        return NVML_ERROR_UNINITIALIZED;
+    }
+    if (index >= s.devices.size()) {
+        return NVML_ERROR_INVALID_ARGUMENT;
+    }
+    *device = s.devices[index].get();
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetName(nvmlDevice_t device, char *name, unsigned int length) {
+    if (const auto r{scenario().enter(device, "GetName")}; r != NVML_SUCCESS) {
+        return r;
+    }
+    if (length <= device->name.size()) {
+        return NVML_ERROR_INSUFFICIENT_SIZE;
+    }
+    std::strcpy(name, device->name.c_str());
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetMemoryInfo(nvmlDevice_t device, nvmlMemory_t *memory) {
+    auto &s{scenario()};
+    if (const auto r{s.enter(device, "GetMemoryInfo")}; r != NVML_SUCCESS) {
+        return r;
+    }
+    constexpr unsigned long long mib{1ULL << 20U};
+    memory->total = device->memory_total * mib;
+    memory->used = std::min(s.rounded(device, fake::memory_used) * mib, memory->total);
+    memory->free = memory->total - memory->used;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetUtilizationRates(nvmlDevice_t device, nvmlUtilization_t *utilization) {
+    auto &s{scenario()};
+    if (const auto r{s.enter(device, "GetUtilizationRates")}; r != NVML_SUCCESS) {
+        return r;
+    }
+    utilization->gpu = s.percent(device, fake::gpu);
+    utilization->memory = s.percent(device, fake::memory);
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetFanSpeed(nvmlDevice_t device, unsigned int *speed) {
+    auto &s{scenario()};
+    if (const auto r{s.enter(device, "GetFanSpeed")}; r != NVML_SUCCESS) {
+        return r;
+    }
+    *speed = s.percent(device, fake::fan);
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetTemperature(nvmlDevice_t device, nvmlTemperatureSensors_t sensorType,
+                                      unsigned int *temp) {
+    auto &s{scenario()};
+    if (const auto r{s.enter(device, "GetTemperature")}; r != NVML_SUCCESS) {
+        return r;
+    }
+    if (sensorType != NVML_TEMPERATURE_GPU) {
+        return NVML_ERROR_INVALID_ARGUMENT;
+    }
+    *temp = s.rounded(device, fake::temp);
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetPowerUsage(nvmlDevice_t device, unsigned int *power) {
+    auto &s{scenario()};
+    if (const auto r{s.enter(device, "GetPowerUsage")}; r != NVML_SUCCESS) {
+        return r;
+    }
+    *power = s.rounded(device, fake::power, 1000);
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetClockInfo(nvmlDevice_t device, nvmlClockType_t type, unsigned int *clock) {
+    auto &s{scenario()};
+    if (const auto r{s.enter(device, "GetClockInfo")}; r != NVML_SUCCESS) {
+        return r;
+    }
+    if (type != NVML_CLOCK_GRAPHICS) {
+        return NVML_ERROR_NOT_SUPPORTED;
+    }
+    *clock = s.rounded(device, fake::clock);
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetGraphicsRunningProcesses_v2(nvmlDevice_t device, unsigned int *infoCount,
+                                                      nvmlProcessInfo_t *infos) {
+    auto &s{scenario()};
+    if (const auto r{s.enter(device, "GetGraphicsRunningProcesses")}; r != NVML_SUCCESS) {
+        return r;
+    }
+    return s.processes(device, false, infoCount, infos);
+}
+
+nvmlReturn_t nvmlDeviceGetComputeRunningProcesses_v2(nvmlDevice_t device, unsigned int *infoCount,
+                                                     nvmlProcessInfo_t *infos) {
+    auto &s{scenario()};
+    if (const auto r{s.enter(device, "GetComputeRunningProcesses")}; r != NVML_SUCCESS) {
+        return r;
+    }
+    return s.processes(device, true, infoCount, infos);
+}
+
+nvmlReturn_t nvmlDeviceGetFieldValues(nvmlDevice_t device, int valuesCount, nvmlFieldValue_t *values) {
+    auto &s{scenario()};
+    if (const auto r{s.enter(device, "GetFieldValues")}; r != NVML_SUCCESS) {
+        return r;
+    }
+    const auto t{s.time()};
+    for (auto &v : std::span{values, static_cast<size_t>(valuesCount)}) {
+        v.timestamp = static_cast<long long>(t * 1e6);
+        v.latencyUsec = 0;
+        switch (v.fieldId) {
+        case NVML_FI_DEV_POWER_AVERAGE:
+        case NVML_FI_DEV_POWER_INSTANT:
+            // Fails like 'GetPowerUsage' does.
+            v.nvmlReturn = s.inject(device->faults, "GetPowerUsage");
+            v.valueType = NVML_VALUE_TYPE_UNSIGNED_INT;
+            v.value.uiVal = s.rounded(device, fake::power, 1000);
+            break;
+        default:
+            v.nvmlReturn = NVML_ERROR_NOT_SUPPORTED;
+        }
+    }
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetSamples(nvmlDevice_t device, nvmlSamplingType_t type,
+                                  unsigned long long lastSeenTimeStamp, nvmlValueType_t *sampleValType,
+                                  unsigned int *sampleCount, nvmlSample_t *samples) {
+    auto &s{scenario()};
+    if (const auto r{s.enter(device, "GetSamples")}; r != NVML_SUCCESS) {
+        return r;
+    }
+    if (type != NVML_GPU_UTILIZATION_SAMPLES) {
+        return NVML_ERROR_NOT_SUPPORTED;
+    }
+    // Timestamps are in us since 'nvmlInit', starting at 1.
+    const auto period{static_cast<unsigned long long>(fake::sample_period.count())};
+    const auto newest{static_cast<unsigned long long>(s.time() * 1e6) / period};
+    const auto kept{std::min<unsigned long long>(newest + 1, fake::sample_buffer)};
+    const auto oldest{std::max(lastSeenTimeStamp / period + 1, newest + 1 - kept)};
+    const auto n{static_cast<unsigned int>(newest + 1 - std::min(oldest, newest + 1))};
+    if (n == 0) {
+        return NVML_ERROR_NOT_FOUND;
+    }
+    if (samples == nullptr) {
+        *sampleCount = n;
+        return NVML_SUCCESS;
+    }
+    if (*sampleCount < n) {
+        *sampleCount = n;
+        return NVML_ERROR_INSUFFICIENT_SIZE;
+    }
+    *sampleValType = NVML_VALUE_TYPE_UNSIGNED_INT;
+    for (unsigned int i{0}; i < n; i++) {
+        const auto k{oldest + i};
+        samples[i].timeStamp = k * period + 1;
+        const auto v{device->curves[fake::gpu].at(static_cast<double>(k * period) / 1e6)};
+        samples[i].sampleValue.uiVal = static_cast<unsigned int>(std::clamp(std::lround(v), 0L, 100L));
+    }
+    *sampleCount = n;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetProcessUtilization(nvmlDevice_t device, nvmlProcessUtilizationSample_t *utilization,
+                                             unsigned int *processSamplesCount,
+                                             unsigned long long lastSeenTimeStamp) {
+    auto &s{scenario()};
+    if (const auto r{s.enter(device, "GetProcessUtilization")}; r != NVML_SUCCESS) {
+        return r;
+    }
+    // The newest sample of 'GetSamples'.
+    const auto period{static_cast<unsigned long long>(fake::sample_period.count())};
+    const auto t{s.time()};
+    const auto newest{static_cast<unsigned long long>(t * 1e6) / period};
+    const auto timestamp{newest * period + 1};
+    if (timestamp <= lastSeenTimeStamp) {
+        return NVML_ERROR_NOT_FOUND;
+    }
+    // Each running PID once. Without allocating, so that the probe's allocation counts are its own.
+    const auto &procs{device->procs};
+    const auto first{[&](size_t i) {
+        const auto same{[&](auto &p) { return p.pid == procs[i].pid && p.running(t); }};
+        return procs[i].running(t) && std::none_of(procs.begin(), procs.begin() + static_cast<long>(i), same);
+    }};
+    unsigned int n{0};
+    for (size_t i{0}; i < procs.size(); i++) {
+        n += first(i) ? 1 : 0;
+    }
+    if (n == 0) {
+        return NVML_ERROR_NOT_FOUND;
+    }
+    if (utilization == nullptr || *processSamplesCount < n) {
+        *processSamplesCount = n;
+        return NVML_ERROR_INSUFFICIENT_SIZE;
+    }
+    const auto v{device->curves[fake::gpu].at(static_cast<double>(newest * period) / 1e6) / n};
+    const auto each{static_cast<unsigned int>(std::clamp(std::lround(v), 0L, 100L))};
+    unsigned int j{0};
+    for (size_t i{0}; i < procs.size(); i++) {
+        if (first(i)) {
+            utilization[j] = {};
+            utilization[j].pid = procs[i].pid;
+            utilization[j].timeStamp = timestamp;
+            utilization[j].smUtil = each;
+            j++;
+        }
+    }
+    *processSamplesCount = n;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetCurrentClocksThrottleReasons(nvmlDevice_t device,
+                                                     unsigned long long *clocksThrottleReasons) {
+    if (const auto r{scenario().enter(device, "GetCurrentClocksThrottleReasons")}; r != NVML_SUCCESS) {
+        return r;
+    }
+    *clocksThrottleReasons = device->throttle;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetPerformanceState(nvmlDevice_t device, nvmlPstates_t *pState) {
+    auto &s{scenario()};
+    if (const auto r{s.enter(device, "GetPerformanceState")}; r != NVML_SUCCESS) {
+        return r;
+    }
+    *pState = static_cast<nvmlPstates_t>(s.value(device, fake::gpu) > 50 ? 0 : 8);
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceGetSupportedEventTypes(nvmlDevice_t device, unsigned long long *eventTypes) {
+    if (const auto r{scenario().enter(device, "GetSupportedEventTypes")}; r != NVML_SUCCESS) {
+        return r;
+    }
+    *eventTypes = nvmlEventTypeXidCriticalError | nvmlEventTypeClock | nvmlEventTypePState;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlEventSetCreate(nvmlEventSet_t *set) {
+    auto &s{scenario()};
+    if (s.inits == 0) {
+        return NVML_ERROR_UNINITIALIZED;
+    }
+    if (const auto r{s.inject(s.faults, "EventSetCreate")}; r != NVML_SUCCESS) {
+        return r;
+    }
+    *set = new nvmlEventSet_st;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlDeviceRegisterEvents(nvmlDevice_t device, unsigned long long eventTypes, nvmlEventSet_t set) {
+    auto &s{scenario()};
+    if (const auto r{s.enter(device, "RegisterEvents")}; r != NVML_SUCCESS) {
+        return r;
+    }
+    if (set == nullptr) {
+        return NVML_ERROR_INVALID_ARGUMENT;
+    }
+    const auto t{s.time()};
+    for (const auto &e : device->events) {
+        if ((e.type & eventTypes) != 0) {
+            set->pending.push_back({device, e, (std::floor(t / e.every) + 1) * e.every});
+        }
+    }
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlEventSetWait_v2(nvmlEventSet_t set, nvmlEventData_t *data, unsigned int timeoutms) {
+    auto &s{scenario()};
+    if (s.inits == 0) {
+        return NVML_ERROR_UNINITIALIZED;
+    }
+    if (set == nullptr) {
+        return NVML_ERROR_INVALID_ARGUMENT;
+    }
+    const auto t{s.time()};
+    const auto timeout{static_cast<double>(timeoutms) / 1000};
+    const auto p{std::min_element(set->pending.begin(), set->pending.end(),
+                                  [](const auto &a, const auto &b) { return a.next < b.next; })};
+    if (p == set->pending.end() || p->next > t + timeout) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{timeoutms});
+        return NVML_ERROR_TIMEOUT;
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>{std::max(p->next - t, 0.0)});
+    *data = {};
+    data->device = p->device;
+    data->eventType = p->e.type;
+    data->eventData = p->e.data;
+    p->next += p->e.every;
+    return NVML_SUCCESS;
+}
+
+nvmlReturn_t nvmlEventSetFree(nvmlEventSet_t set) {
+    delete set;
+    return NVML_SUCCESS;
+}
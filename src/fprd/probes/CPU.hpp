@@ -11,42 +11,99 @@
 #include <unistd.h>
 
 #include <chrono>
+#include <cmath>
 #include <dbg/Log.hpp>
 #include <dbg/Logger.hpp>
-#include <filesystem>
+#include <fprd/Config.hpp>
+#include <fprd/probes/ProcEvents.hpp>
+#include <fprd/probes/ProcReader.hpp>
+#include <fprd/probes/Root.hpp>
+#include <fprd/probes/Taskstats.hpp>
 #include <fprd/probes/UNIX.hpp>
-#include <fprd/util/istream.hpp>
+#include <fprd/util/FdCache.hpp>
+#include <fprd/util/HashMap.hpp>
+#include <fprd/util/TopK.hpp>
+#include <fprd/util/WorkerPool.hpp>
+#include <fprd/util/file.hpp>
 #include <fprd/util/ranges.hpp>
+#include <fprd/util/scanner.hpp>
 #include <fprd/util/time.hpp>
 #include <fprd/util/to_string.hpp>
-#include <fstream>
 #include <future>
+#include <memory>
+#include <optional>
 #include <sstream>
 
 namespace fprd {
 using namespace ::std;
-using namespace ::std::filesystem;
 
 namespace probe {
 
-/// Utility function for parsing values from UNIX human-readable files.
-/// @param is
-/// @return auto
-auto getval(istream &is) {
-    const auto l{getline(is)};
-    const auto itr{l.find(':')};
-    return l.substr(itr + 1, numeric_limits<size_t>::max());
+/// Obtain the IDs of the online CPU threads from a list like '0-3,8-11'.
+/// @param list The contents of '/sys/devices/system/cpu/online'.
+/// @return vector<uint>
+auto parse_cpu_list(string_view list) {
+    vector<uint> cpus;
+    Scanner s{list};
+    while (!s.empty()) {
+        Scanner range{s.get_until(',')};
+        const auto first{range.getuint()};
+        range.skip_to('-');
+        const auto last{range.empty() ? first : range.getuint()};
+        for (auto i{first}; i <= last; i++) {
+            cpus.push_back(i);
+        }
+        s.skip_ws();
+    }
+    return cpus;
 }
 
-/// Get basic CPU info.
-/// @return auto CPU name and thread count.
+/// Get basic CPU info. Only called once at startup.
+/// @return auto CPU name and the IDs of the online threads.
 auto get_cpu_info() {
-    ifstream is{"/proc/cpuinfo"};
-    skip_lines(is, 4);
-    const auto name{getval(is)};
-    skip_lines(is, 5);
-    const auto thread_count{stoul(getval(is))};
-    return make_pair(name, thread_count);
+    FileBuffer buf{1 << 16};
+    Scanner s{buf.read(probe_path("/proc/cpuinfo").c_str())};
+    string name;
+    size_t processors{0};
+    while (!s.empty()) {
+        const auto l{s.getline()};
+        if (l.starts_with("processor")) {
+            processors++;
+        } else if (name.empty() && l.starts_with("model name")) {
+            name = Scanner{l}.getval();
+        }
+    }
+
+    auto cpus{parse_cpu_list(buf.read(probe_path("/sys/devices/system/cpu/online").c_str()))};
+    if (cpus.empty()) {
+        // Assume all of them are online.
+        for (auto i{0U}; i < processors; i++) {
+            cpus.push_back(i);
+        }
+    }
+    return make_pair(name, cpus);
+}
+
+/// The reverse of 'parse_cpu_list'.
+/// @param cpus Sorted CPU IDs.
+/// @return string A list like '0-3,8-11'.
+auto format_cpu_list(const vector<uint> &cpus) {
+    string list;
+    for (size_t i{0}; i < cpus.size();) {
+        auto j{i};
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+            j++;
+        }
+        if (!list.empty()) {
+            list += ',';
+        }
+        list += to_string(cpus[i]);
+        if (j != i) {
+            list += '-' + to_string(cpus[j]);
+        }
+        i = j + 1;
+    }
+    return list;
 }
 
 /// UsageInfo for the entire CPU.
@@ -82,54 +139,63 @@ struct CPUUsage {
 /// The raw CPU usage info shows the LIFETIME usage of the CPU.
 /// This means that to compute the CURRENT usage, we must compute the delta.
 /// This function obtains the LIFETIME usage.
-/// @param thread_count
-/// @return CPUUsageInfo
-auto get_cpu_lifetime_usage(size_t thread_count) -> CPUUsage {
-    ifstream is{"/proc/stat"};
+/// @param stat The contents of '/proc/stat'.
+/// @param usage Output. 'threads' must already be sized to the thread count.
+auto get_cpu_lifetime_usage(string_view stat, CPUUsage &usage) {
+    Scanner s{stat};
 
     /// @return auto idle and total time.
     auto parse_line{[&]() -> CPUUsage::Usage {
-        skip_to(is, ' '); // Skip CPU name.
+        s.skip_to(' '); // Skip CPU name.
         ulong total{0};
         ulong idle{0};
         for (auto i{0}; i < 10; i++) {
-            const auto l{getulong(is)};
+            const auto l{s.getulong()};
             if (i == 3) {
                 // The 3rd number is the total idle time.
                 idle += l;
             }
             total += l;
         }
-        skip_lines(is, 1); // Skip the rest of the current line.
+        s.skip_lines(1); // Skip the rest of the current line.
         return {total, idle};
     }};
 
     // First line is the average of all threads (cores).
-    const auto overall{parse_line()};
+    usage.overall = parse_line();
     // Beyond the first line is all the individual threads (cores).
-    const auto threads{[&] {
-        vector<CPUUsage::Usage> r(thread_count);
-        for (auto &u : r) {
-            u = parse_line();
-        }
-        return r;
-    }()};
+    for (auto &u : usage.threads) {
+        u = parse_line();
+    }
+}
 
-    return {overall, threads};
+/// @return ulong When the system booted, in seconds since the epoch. 0 if unknown.
+auto get_boot_time() {
+    FileBuffer buf{1 << 16};
+    Scanner s{buf.read(probe_path("/proc/stat").c_str())};
+    while (!s.empty()) {
+        if (const auto l{s.getline()}; l.starts_with("btime ")) {
+            Scanner v{l};
+            v.skip_to(' ');
+            return v.getulong();
+        }
+    }
+    return 0UL;
 }
 
 /// Get the current frequencies of the entire CPU.
-/// @tparam thread_count
-/// @return auto Frequency of each thread in MHz
-auto get_cpu_freqs(size_t thread_count) {
-    ifstream is{"/proc/cpuinfo"};
-    skip_lines(is, 7); // Skip first two lines.
-    vector<float> freqs(thread_count);
-    for (auto &freq : freqs) {
-        freq = stof(getval(is));
-        skip_lines(is, 27);
+/// Only used when cpufreq is not available: reading '/proc/cpuinfo' makes the kernel sample every CPU, which
+/// wakes up idle cores.
+/// @param cpuinfo The contents of '/proc/cpuinfo'.
+/// @param freqs Output. Frequency of each thread in MHz. Must already be sized to the thread count.
+auto get_cpu_freqs(string_view cpuinfo, vector<float> &freqs) {
+    Scanner s{cpuinfo};
+    auto freq{freqs.begin()};
+    while (!s.empty() && freq != freqs.end()) {
+        if (const auto l{s.getline()}; l.starts_with("cpu MHz")) {
+            *freq++ = stof(Scanner{l}.getval());
+        }
     }
-    return freqs;
 }
 
 /// For querying CPU related stuff.
@@ -147,9 +213,42 @@ template <size_t max_procs> class CPU {
         long use; // lifetime usage.
     };
 
+    /// Identifies a process. PIDs get reused, so the start time is needed to tell processes apart.
+    struct ProcessKey {
+        pid_t pid;
+        ulong start; // Clock ticks since boot.
+
+        bool operator==(const ProcessKey &) const = default;
+
+        struct Hash {
+            size_t operator()(const ProcessKey &k) const {
+                auto h{(static_cast<size_t>(k.pid) ^ (k.start << 22U)) * 0x9e3779b97f4a7c15ULL};
+                return h ^ (h >> 32U);
+            }
+        };
+    };
+
+    /// What we remember about a process between scans.
+    struct TrackedProcess {
+        long use;                // lifetime usage.
+        uint scan;               // The last scan that saw this process.
+        ulong exited_threads{0}; // usec. CPU time in the exit records of its threads, while it was alive.
+    };
+
+    /// Exit records of a process that are not accounted for yet.
+    struct ExitedProcess {
+        ulong time;           // usec. CPU time of all its threads.
+        ulong rss;            // KB. Peak.
+        array<char, 64> comm; // Of the main thread, if it was seen.
+        ulong start;          // Seconds since boot. Only the record of the main thread tells it.
+        bool started;         // Whether 'start' is known.
+        uint scan;            // The scan that first saw a record, while 'start' is not known.
+    };
+
     /// Used when sorting processes.
     struct ProcessUsage : public BasicProcess {
-        float usage; // % current usage.
+        float usage;   // % current usage.
+        ProcStat stat; // Everything needed to show the process, so that it does not have to be read again.
     };
 
   public:
@@ -181,10 +280,20 @@ template <size_t max_procs> class CPU {
             return os.str();
         }
 
-        bool operator==(const Process &rhs) const { return this->pid == rhs.pid; }
+        /// What is recorded of a process. The rest is only needed while probing.
+        /// @param p
+        /// @return auto
+        static auto fields(auto &p) { return tie(p.pid, p.usage, p.name, p.mode, p.mem); }
+
+        /// Exited processes have no PID, and are told apart by name.
+        bool operator==(const Process &rhs) const { return this->pid == rhs.pid && name == rhs.name; }
 
         ostream &print(ostream &os) const {
-            os << setfill(' ') << right << setw(pidw) << this->pid;
+            if (this->pid == 0) {
+                os << setfill(' ') << right << setw(pidw) << "-";
+            } else {
+                os << setfill(' ') << right << setw(pidw) << this->pid;
+            }
             os << " ";
             os << setfill(' ') << right << setw(mw) << mode;
             os << " ";
@@ -206,30 +315,117 @@ template <size_t max_procs> class CPU {
         short temp;                   // Celsius
         int mem_free;                 // KB
 
-        vector<Process> procs; // Processes.
+        vector<Process> procs; // Processes. Only valid if 'scanned'.
+        bool scanned;          // 'procs' is scanned every 'cpu_proc_interval' only.
+
+        /// @param d
+        /// @return auto
+        static auto fields(auto &d) { return tie(d.threads, d.avg, d.temp, d.mem_free, d.procs, d.scanned); }
     };
 
     const string name;
     const size_t thread_count;
     const int mem_total; // KB
 
-    /// Save the LIFETIME usage for all processes in the system.
-    /// This is needed to compute the CURRENT usage.
-    /// See 'get_cpu_lifetime_usage' for a more detailed explanation.
-    vector<BasicProcess> tracked_procs;
-    CPUUsage prev_usage;
+    CPUUsage prev_usage{};
 
+  private:
+    /// Sort key of the process list. Ties are broken by PID, so that the result does not depend on the scan order.
+    struct ByUsage {
+        auto operator()(const ProcessUsage &p) const { return make_pair(p.usage, p.pid); }
+    };
+    using TopProcesses = TopK<ProcessUsage, max_procs, ByUsage>;
+    /// Below this many processes, the shards are scanned one after another.
+    static constexpr size_t parallel_scan_threshold{2048};
+
+    /// The processes are split by PID into shards, which can be scanned in parallel.
+    /// Everything a scan touches is per-shard, so the shards share nothing.
+    struct Shard {
+        /// Save the LIFETIME usage for all processes in the shard.
+        /// This is needed to compute the CURRENT usage.
+        /// See 'get_cpu_lifetime_usage' for a more detailed explanation.
+        HashMap<ProcessKey, TrackedProcess, typename ProcessKey::Hash> tracked;
+        /// Exit records whose process is not known yet, by PID. See 'drain_exits'.
+        HashMap<pid_t, ExitedProcess, IntHash> unresolved;
+        /// Exit records that were not accounted for yet, by process. The start times are in seconds since boot,
+        /// which is all that exit records tell, so look them up with 'find_started'.
+        HashMap<ProcessKey, ExitedProcess, typename ProcessKey::Hash> exited;
+        /// The last usage of the processes that disappeared in the last two scans. Keyed like 'exited'.
+        /// Their exit records are only counted from this point. The usage includes the threads that exited before,
+        /// whose records are in 'exited_threads', and the threads that were still running, whose records come
+        /// after.
+        HashMap<ProcessKey, TrackedProcess, typename ProcessKey::Hash> vanished;
+        /// Reads the stat files of the processes in batches.
+        ProcStatReader reader;
+        /// The PIDs to scan this tick.
+        vector<pid_t> pids;
+        /// The busiest processes of this shard.
+        TopProcesses top;
+
+        /// @param dir
+        /// @param shards
+        Shard(const ProcDir &dir, size_t shards) : reader{dir, static_cast<unsigned>(shards)} {}
+    };
+
+    /// The files we read every tick are kept open.
+    FdCache files;
+    const FdCache::Handle stat_file{files.add(probe_path("/proc/stat"))};
+    const FdCache::Handle meminfo_file{files.add(probe_path("/proc/meminfo"))};
+    // Ad-hoc way of getting temperatures in FPR's machine in Dec. 2020.
+    // Masu, fuck you btw.
+    const FdCache::Handle temp_file{files.add(probe_path("/sys/class/thermal/thermal_zone2/temp"))};
+    /// 'cpufreq/scaling_cur_freq' of each thread. Empty if cpufreq is not available.
+    vector<FdCache::Handle> freq_files;
+    /// Only used without cpufreq.
+    optional<FdCache::Handle> cpuinfo_file;
+    /// Reused for reading the large files ('/proc/stat' and '/proc/cpuinfo').
+    FileBuffer buf{1 << 16};
+    /// The live processes. Updated from fork/exit events when possible.
+    ProcessTracker procs;
+    /// Scans the shards in parallel.
+    WorkerPool pool{max(proc_scan_threads, 1U)};
+    vector<unique_ptr<Shard>> shards;
+    /// Reused for reading small files, or the beginning of files.
+    array<char, 1024> proc_buf;
+    /// Final CPU time of processes that exit between scans.
+    TaskstatsListener exits;
+    /// Seconds since the epoch. Exit records tell the start times of processes relative to it.
+    const ulong boot_time{get_boot_time()};
+    static inline const auto ticks_per_sec{static_cast<ulong>(::sysconf(_SC_CLK_TCK))};
+    /// Scratch space for grouping the exited processes by name.
+    vector<ProcessUsage> exited_groups;
+    /// Counts calls to 'read_proc'. Processes that were not seen in the latest scan are gone.
+    uint scan{0};
+    /// The processes are scanned every this many calls to 'update'.
+    static inline const auto ticks_per_scan{
+        max(static_cast<long>(ceil(duration<double>{cpu_proc_interval} / cpu_probe_interval)), 1L)};
+    /// Calls to 'update' until the next scan.
+    long ticks_to_scan{0};
+    /// CPU time used since the last scan, which the usage of the processes is relative to.
+    ulong use_since_scan{0};
+    /// Scratch space so that each tick can reuse the same memory.
+    CPUUsage usage{};
+    vector<float> freqs;
+
+  public:
     CPU() : CPU{get_cpu_info()} {}
     CPU(const CPU &) = delete;
 
-    [[nodiscard]] auto update() {
+    /// @param data Overwritten. Pass the same one again and again, so that its memory is reused.
+    void update(DynamicData &data) {
         dbg(const auto tp{now()});
 
-        DynamicData data;
         data.threads.resize(thread_count);
 
-        const auto freqs{get_cpu_freqs(thread_count)};
-        const auto usage{get_cpu_lifetime_usage(thread_count)};
+        if (cpuinfo_file) {
+            get_cpu_freqs(files.read(*cpuinfo_file, buf), freqs);
+        } else {
+            for (auto [freq, h] : zip(freqs, freq_files)) {
+                // kHz
+                freq = static_cast<float>(stou(files.read(h, proc_buf))) / 1000;
+            }
+        }
+        get_cpu_lifetime_usage(files.read(stat_file, buf), usage);
         for (auto [ts, freq, usage, prev_usage] : zip(data.threads, freqs, usage.threads, prev_usage.threads)) {
             ts.usage = prev_usage.get_current_usage(usage);
             ts.freq = freq;
@@ -238,131 +434,271 @@ template <size_t max_procs> class CPU {
         }
         auto [d_total_use, d_total_idle]{prev_usage.overall.get_current_usage_pair(usage.overall)};
         data.avg.usage = (float)d_total_use / d_total_idle;
-        data.avg.freq = [&freqs] {
+        data.avg.freq = [this] {
             float avg{0};
             for_each(freqs.begin(), freqs.end(), [&avg, count = freqs.size()](auto f) { avg += f / count; });
             return avg;
         }();
         prev_usage.overall = usage.overall;
 
-        data.temp = [] {
-            // Ad-hoc way of getting temperatures in FPR's machine in Dec. 2020.
-            // Masu, fuck you btw.
-            ifstream is{"/sys/class/thermal/thermal_zone2/temp"};
-            return getulong(is) / 1000;
-        }();
-        data.procs = read_proc(d_total_use);
+        data.temp = static_cast<short>(stou(files.read(temp_file, proc_buf)) / 1000);
+        use_since_scan += d_total_use;
+        data.scanned = ticks_to_scan == 0;
+        if (data.scanned) {
+            read_proc(use_since_scan, data.procs);
+            use_since_scan = 0;
+            ticks_to_scan = ticks_per_scan;
+        }
+        ticks_to_scan--;
 
-        data.mem_free = [] {
-            ifstream is{"/proc/meminfo"};
-            skip_lines(is, 2);
-            return stoi(getval(is));
+        data.mem_free = [this] {
+            Scanner s{files.read(meminfo_file, proc_buf)};
+            s.skip_lines(2);
+            return stou<uint>(s.getval());
         }();
 
-        dbg_out("CPU data: " << diff(tp) << "ms");
-        return data;
+        dbg_out("CPU data: " << diff(tp) << "ms, cached files: " << files
+                             << ", lost exit records: " << exits.overflow_count());
     }
 
   private:
-    CPU(pair<string, size_t> name_thread_count)
-        : name{name_thread_count.first}, thread_count{name_thread_count.second}, mem_total{[] {
-              ifstream is{"/proc/meminfo"};
+    CPU(pair<string, vector<uint>> name_cpus)
+        : name{name_cpus.first}, thread_count{name_cpus.second.size()}, mem_total{[] {
+              array<char, 128> buf;
+              Scanner s{read_file(probe_path("/proc/meminfo").c_str(), buf)};
               // Get total memory (1st line).
-              return stoi(getval(is));
-          }()} {
+              return static_cast<int>(stou<uint>(s.getval()));
+          }()},
+          exits{format_cpu_list(name_cpus.second)} {
         prev_usage.threads.resize(thread_count);
+        usage.threads.resize(thread_count);
+        freqs.resize(thread_count);
+        for (size_t i{0}; i < pool.size(); i++) {
+            shards.push_back(make_unique<Shard>(procs.dir(), pool.size()));
+        }
+
+        const auto freq_path{[](uint cpu) {
+            return probe_path("/sys/devices/system/cpu/cpu" + to_string(cpu) + "/cpufreq/scaling_cur_freq");
+        }};
+        if (!all_of(name_cpus.second.begin(), name_cpus.second.end(),
+                    [&](auto cpu) { return ::access(freq_path(cpu).c_str(), R_OK) == 0; })) {
+            // No cpufreq (e.g. in VMs). Fall back to '/proc/cpuinfo' for everything.
+            cpuinfo_file = files.add(probe_path("/proc/cpuinfo"));
+            return;
+        }
+        for (auto cpu : name_cpus.second) {
+            freq_files.push_back(files.add(freq_path(cpu)));
+        }
     }
 
-    auto is_number(string_view s) {
-        return all_of(s.begin(), s.end(), [](auto c) { return '0' <= c && c <= '9'; });
+    /// @param pid
+    /// @return Shard& The shard that 'pid' belongs to.
+    Shard &shard_of(pid_t pid) { return *shards[static_cast<size_t>(pid) % shards.size()]; }
+
+    /// Exit records and '/proc' round the start time of a process differently.
+    /// @tparam V
+    /// @param m Keyed by PID and start time in seconds since boot.
+    /// @param pid
+    /// @param start Seconds since boot.
+    /// @return optional<ProcessKey> The key of the process 'pid' that started at 'start', give or take a second.
+    template <class V>
+    static optional<ProcessKey> find_started(HashMap<ProcessKey, V, typename ProcessKey::Hash> &m, pid_t pid,
+                                             ulong start) {
+        for (const auto s : {start, start + 1, start - 1}) {
+            if (m.find({pid, s}) != nullptr) {
+                return ProcessKey{pid, s};
+            }
+        }
+        return nullopt;
     }
 
-    auto read_proc(unsigned long current_cpu_usage) {
-        const auto sorted{[&] {
-            vector<ProcessUsage> procs;
-            for (const auto &d : directory_iterator("/proc")) {
-                // Skip non-directories
-                if (!d.is_directory()) {
-                    continue;
+    /// Collect the exit records that arrived since the last scan.
+    /// A record tells the start time of its thread, so the process of a record is only known for the main
+    /// thread. The records of the other threads wait in 'unresolved' until the record of the main thread comes,
+    /// or are matched to the running process with that PID. That way, the records of a process are never
+    /// credited to a newer one that got the same PID.
+    void drain_exits() {
+        exits.drain([this](const taskstats &ts) {
+            auto [e, added]{shard_of(static_cast<pid_t>(ts.ac_tgid)).unresolved.try_emplace(ts.ac_tgid)};
+            if (added) {
+                e.scan = scan;
+            }
+            e.time += ts.ac_utime + ts.ac_stime;
+            e.rss = max<ulong>(e.rss, ts.hiwater_rss);
+            if (e.comm[0] == '\0' || ts.ac_pid == ts.ac_tgid) {
+                // Prefer the name of the main thread.
+                e.comm.fill('\0');
+                copy_n(ts.ac_comm, min(sizeof(ts.ac_comm), e.comm.size() - 1), e.comm.data());
+            }
+            if (ts.ac_pid == ts.ac_tgid) {
+                e.start = ts.ac_btime > boot_time ? ts.ac_btime - boot_time : 0;
+                e.started = true;
+            }
+        });
+
+        for (auto &shard : shards) {
+            shard->unresolved.erase_if([&](pid_t pid, const ExitedProcess &e) {
+                auto start{e.start};
+                if (!e.started) {
+                    // Only other threads exited. The process is still running, or the record of its main thread
+                    // comes later.
+                    const auto stat{parse_proc_stat(procs.dir().read(pid, "stat", proc_buf))};
+                    if (stat.pid == 0) {
+                        // Records that were lost never come.
+                        return scan - e.scan >= 2;
+                    }
+                    start = stat.start / ticks_per_sec;
                 }
-                // Skip directories that are not PIDs (number).
-                const auto &p{d.path()};
-                if (!is_number(p.stem().string())) {
-                    continue;
+                const auto k{find_started(shard->exited, pid, start)};
+                auto &x{shard->exited.try_emplace(k.value_or(ProcessKey{pid, start})).first};
+                x.time += e.time;
+                x.rss = max(x.rss, e.rss);
+                if (x.comm[0] == '\0' || e.started) {
+                    x.comm = e.comm;
                 }
+                return true;
+            });
+        }
+    }
 
-                ifstream is{p / "stat"};
-                // First data is the PID.
-                pid_t pid{getint(is)};
-
-                auto &bproc{[pid, this]() -> decltype(auto) {
-                    if (const auto itr{find_if(tracked_procs.begin(), tracked_procs.end(),
-                                               [pid](auto &p) { return p.pid == pid; })};
-                        itr != tracked_procs.end()) {
-                        return *itr;
-                    }
-
-                    // Insert a new basic proc.
-                    return tracked_procs.emplace_back(pid, 0);
-                }()};
-
-                /// Skip to usage data.
-                skip_to(is, ')');
-                for (auto i{0}; i < 13; i++) {
-                    skip_to(is, ' ');
+    /// Turn the exit records of the processes that are gone into usage, grouped by name.
+    /// @param current_cpu_usage
+    /// @param top
+    void account_exits(unsigned long current_cpu_usage, TopProcesses &top) {
+        static const auto page_size{::sysconf(_SC_PAGE_SIZE)};
+
+        exited_groups.clear();
+        for (auto &shard : shards) {
+            shard->exited.for_each([&](const ProcessKey &key, const ExitedProcess &e) {
+                auto time{e.time};
+                const auto k{find_started(shard->vanished, key.pid, key.start)};
+                const auto *const v{k ? shard->vanished.find(*k) : nullptr};
+                if (v != nullptr) {
+                    // The whole process: the threads that exited while it was alive, and the rest.
+                    time += v->exited_threads;
                 }
-
-                const auto last_use{bproc.use};
-                bproc.use = [&]() {
-                    ulong sum{};
-                    sum += getulong(is);
-                    sum += getulong(is);
-                    sum += getulong(is);
-                    sum += getulong(is);
-                    return sum;
-                }();
-
-                ProcessUsage usage{bproc};
-                const auto diff{bproc.use - last_use};
-                /// Skip if usage is 0.
-                if (diff == 0) {
-                    continue;
+                auto use{static_cast<long>(time * ticks_per_sec / 1000000)};
+                // Only count what happened after the last scan that saw it.
+                if (v != nullptr) {
+                    use -= v->use;
                 }
+                if (use <= 0) {
+                    return;
+                }
+                auto g{find_if(exited_groups.begin(), exited_groups.end(),
+                               [&e](const ProcessUsage &g) { return g.stat.comm == e.comm; })};
+                if (g == exited_groups.end()) {
+                    g = exited_groups.insert(g, {{0, 0}, 0, {}});
+                    g->stat.comm = e.comm;
+                    g->stat.state = 'X';
+                }
+                g->use += use;
+                g->stat.rss = max(g->stat.rss, static_cast<long>(e.rss * 1024 / page_size));
+            });
+            shard->exited.clear();
+            shard->vanished.erase_if([this](auto & /* key */, auto &v) { return scan - v.scan >= 2; });
+        }
+        for (auto &g : exited_groups) {
+            g.usage = static_cast<float>(g.use) / static_cast<float>(current_cpu_usage) * 100;
+            top.push(g);
+        }
+    }
 
-                usage.usage = static_cast<float>(diff) / static_cast<float>(current_cpu_usage) * 100;
-
-                procs.push_back(usage);
+    /// Scan the processes of one shard.
+    /// Only touches the shard, so that shards can be scanned in parallel.
+    /// @param shard
+    /// @param current_cpu_usage
+    void scan_shard(Shard &shard, unsigned long current_cpu_usage) {
+        shard.top.clear();
+        shard.reader.read_all(shard.pids, [&](pid_t /* pid */, string_view contents) {
+            const auto stat{parse_proc_stat(contents)};
+            if (stat.pid == 0) {
+                // The process exited.
+                return;
+            }
+            auto &tracked{shard.tracked.try_emplace({stat.pid, stat.start}).first};
+            // Exit records of a live process are from its threads, which are already in its usage. They are kept
+            // for when the whole process exits, since its usage at the last scan includes them.
+            if (const auto k{find_started(shard.exited, stat.pid, stat.start / ticks_per_sec)}) {
+                tracked.exited_threads += shard.exited.find(*k)->time;
+                shard.exited.erase(*k);
             }
+            tracked.scan = scan;
+            const auto last_use{tracked.use};
+            // With exit records, children are accounted for on their own.
+            tracked.use = exits.valid() ? stat.own_cpu_time() : stat.cpu_time();
+
+            ProcessUsage usage{{stat.pid, tracked.use}, 0, stat};
+            const auto diff{tracked.use - last_use};
+            /// Skip if usage is 0.
+            if (diff == 0) {
+                return;
+            }
+
+            usage.usage = static_cast<float>(diff) / static_cast<float>(current_cpu_usage) * 100;
 
-            // Sort the processes by usage.
-            sort(procs.begin(), procs.end(), [&](auto &lhs, auto &rhs) { return lhs.usage > rhs.usage; });
+            shard.top.push(usage);
+        });
 
-            // Shrink the vector to the maximum size if needed.
-            if (procs.size() > max_procs) {
-                return vector<ProcessUsage>(procs.begin(), procs.begin() + max_procs);
+        // Forget the processes that are gone, so that the table only holds live processes.
+        shard.tracked.erase_if([&](auto &key, auto &p) {
+            if (p.scan == scan) {
+                return false;
             }
-            return procs;
-        }()};
-
-        vector<Process> procs;
-        for (auto p : sorted) {
-            Process proc{p};
-            ifstream is{"/proc/" + to_string(p.pid) + "/stat"};
-            skip_to(is, ')');
-            proc.name = get_name(proc.pid);
-            proc.mode = getchar(is);
-            for (auto i{0}; i < 14; i++) {
-                skip_to(is, ' ');
+            if (exits.valid()) {
+                shard.vanished.try_emplace({key.pid, key.start / ticks_per_sec}).first = {p.use, scan,
+                                                                                           p.exited_threads};
             }
-            for (auto i{0}; i < 7; i++) {
-                skip_to(is, ' ');
+            return true;
+        });
+    }
+
+    /// @param current_cpu_usage
+    /// @param shown Resized and assigned in place, so that the names keep their memory.
+    void read_proc(unsigned long current_cpu_usage, vector<Process> &shown) {
+        scan++;
+        for (auto &shard : shards) {
+            shard->pids.clear();
+        }
+        drain_exits();
+        size_t count{0};
+        procs.for_each_pid([&](pid_t pid) {
+            shard_of(pid).pids.push_back(pid);
+            count++;
+        });
+
+        const auto scan_part{[&](size_t i) { scan_shard(*shards[i], current_cpu_usage); }};
+        if (count >= parallel_scan_threshold) {
+            pool.run(scan_part);
+        } else {
+            // Waking up the workers costs more than it saves.
+            for (size_t i{0}; i < shards.size(); i++) {
+                scan_part(i);
             }
-            proc.mem = static_cast<float>((double)getulong(is) * 1e-6 * (double)::sysconf(_SC_PAGE_SIZE));
+        }
 
-            procs.push_back(proc);
+        TopProcesses top;
+        for (auto &shard : shards) {
+            for (const auto &p : shard->top.sorted()) {
+                top.push(p);
+            }
+        }
+        if (exits.valid()) {
+            account_exits(current_cpu_usage, top);
         }
 
-        return procs;
+        static const auto page_size{::sysconf(_SC_PAGE_SIZE)};
+        // Sorted by usage.
+        const auto sorted{top.sorted()};
+        shown.resize(sorted.size());
+        for (size_t i{0}; i < sorted.size(); i++) {
+            const auto &p{sorted[i]};
+            auto &proc{shown[i]};
+            static_cast<ProcessUsage &>(proc) = p;
+            proc.name = p.stat.name();
+            proc.mode = p.stat.state;
+            proc.mem = static_cast<float>((double)p.stat.rss * 1e-6 * (double)page_size);
+        }
     }
 };
 }; // namespace probe
@@ -0,0 +1,227 @@
+/// @file Fixture.hpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <dbg/Log.hpp>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fprd {
+using namespace ::std;
+
+/// Generates a fake '/proc' and '/sys' tree, so that the probes can run offline with identical inputs, e.g. in
+/// benchmarks. Only the files that the probes read are generated.
+/// Point the probes at it with 'probe_root() = fixture.root().string()' before creating them.
+/// Everything is derived from the seed: the same parameters always give the same tree, tick after tick.
+class ProcFixture {
+  public:
+    /// The shape of the system.
+    struct Params {
+        uint cpus{8};
+        uint processes{1000};
+        float churn{0.01F}; // Fraction of the processes that exit (and are replaced by new ones) every tick.
+        uint seed{1};
+    };
+
+  private:
+    /// A fake process.
+    struct Process {
+        pid_t pid;
+        ulong utime; // Clock ticks.
+        ulong stime; // Clock ticks.
+        ulong start; // Clock ticks since boot.
+        long rss;    // Pages.
+    };
+
+    /// Clock ticks per tick (1 second at USER_HZ = 100).
+    static constexpr ulong hz{100};
+
+    const filesystem::path dir;
+    const Params params;
+    mt19937 rng;
+    vector<Process> procs;
+    pid_t next_pid{300};
+    /// Clock ticks since boot.
+    ulong uptime{0};
+    /// user, nice, system, idle, ... of each CPU.
+    vector<array<ulong, 10>> cpu_times;
+
+    /// @param n
+    /// @return ulong A random number in [0, n).
+    ulong random(ulong n) { return n == 0 ? 0 : rng() % n; }
+
+    /// @param path Relative to the root.
+    /// @param contents
+    void write(const filesystem::path &path, string_view contents) {
+        ofstream f{dir / path, ios::trunc};
+        f << contents;
+        if (!f) {
+            fatal_error("Failed to write " << (dir / path));
+        }
+    }
+
+    /// @param p
+    /// @return filesystem::path '/proc/<pid>'.
+    [[nodiscard]] filesystem::path proc_dir(const Process &p) const { return dir / "proc" / to_string(p.pid); }
+
+    /// Create a process that started just now.
+    void spawn() {
+        Process p{next_pid++, 0, 0, uptime, static_cast<long>(100 + random(50000))};
+        filesystem::create_directories(proc_dir(p));
+        procs.push_back(p);
+    }
+
+    /// Write '/proc/<pid>/stat' in the format of proc(5).
+    /// @param p
+    void write_stat(const Process &p) {
+        ostringstream os;
+        os << p.pid << " (fake-" << p.pid % 97 << ") " << "RSDI"[p.pid % 4] << " 1 " << p.pid << " " << p.pid
+           << " 0 -1 4194304 100 0 0 0 " << p.utime << " " << p.stime << " 0 0 20 0 1 0 " << p.start << " "
+           << p.rss * 4096 * 4 << " " << p.rss;
+        for (auto i{0}; i < 28; i++) {
+            os << " 0";
+        }
+        os << "\n";
+        write(proc_dir(p) / "stat", os.str());
+    }
+
+    /// Write the system-wide files.
+    void write_system() {
+        ostringstream stat;
+        array<ulong, 10> total{};
+        for (const auto &c : cpu_times) {
+            for (size_t i{0}; i < c.size(); i++) {
+                total[i] += c[i];
+            }
+        }
+        const auto line{[&stat](string_view name, const array<ulong, 10> &c) {
+            stat << name;
+            for (auto t : c) {
+                stat << " " << t;
+            }
+            stat << "\n";
+        }};
+        line("cpu ", total);
+        for (size_t i{0}; i < cpu_times.size(); i++) {
+            line("cpu" + to_string(i), cpu_times[i]);
+        }
+        stat << "ctxt 0\nbtime 0\nprocesses " << next_pid << "\nprocs_running 1\nprocs_blocked 0\n";
+        write("proc/stat", stat.str());
+
+        const auto mem_total{16UL << 20U};
+        write("proc/meminfo", "MemTotal:       " + to_string(mem_total) + " kB\nMemFree:        " +
+                                  to_string(mem_total / 2 + random(mem_total / 4)) + " kB\nMemAvailable:   " +
+                                  to_string(mem_total / 2) + " kB\n");
+
+        for (uint cpu{0}; cpu < params.cpus; cpu++) {
+            write("sys/devices/system/cpu/cpu" + to_string(cpu) + "/cpufreq/scaling_cur_freq",
+                  to_string(800000 + random(4000000)) + "\n");
+        }
+        write("sys/class/thermal/thermal_zone2/temp", to_string(30000 + random(60000)) + "\n");
+    }
+
+  public:
+    /// Create the tree. Existing files in 'root' are overwritten, but nothing is deleted.
+    /// @param root
+    /// @param params
+    ProcFixture(filesystem::path root, Params params)
+        : dir{move(root)}, params{params}, rng{params.seed}, cpu_times(params.cpus) {
+        filesystem::create_directories(dir / "proc");
+        filesystem::create_directories(dir / "sys/class/thermal/thermal_zone2");
+        for (uint cpu{0}; cpu < params.cpus; cpu++) {
+            filesystem::create_directories(dir / ("sys/devices/system/cpu/cpu" + to_string(cpu) + "/cpufreq"));
+        }
+
+        ostringstream cpuinfo;
+        for (uint cpu{0}; cpu < params.cpus; cpu++) {
+            cpuinfo << "processor\t: " << cpu << "\nmodel name\t: Fake CPU @ 3.00GHz\ncpu MHz\t\t: 3000.000\n\n";
+        }
+        write("proc/cpuinfo", cpuinfo.str());
+        write("sys/devices/system/cpu/online", "0-" + to_string(params.cpus - 1) + "\n");
+
+        procs.reserve(params.processes);
+        for (uint i{0}; i < params.processes; i++) {
+            spawn();
+        }
+        tick();
+    }
+    /// Copying is not allowed.
+    ProcFixture(const ProcFixture &) = delete;
+
+    /// @return const filesystem::path& The directory to use as the probe root.
+    [[nodiscard]] const filesystem::path &root() const { return dir; }
+
+    /// @return size_t The number of processes right now.
+    [[nodiscard]] size_t process_count() const { return procs.size(); }
+
+    /// @tparam F
+    /// @param f Called as 'f(pid, time)' with the lifetime CPU time of each process, in clock ticks.
+    template <class F> void for_each_process(F f) const {
+        for (const auto &p : procs) {
+            f(p.pid, p.utime + p.stime);
+        }
+    }
+
+    /// @return ulong The time that all CPUs together have been busy for, in clock ticks.
+    [[nodiscard]] ulong busy_time() const {
+        ulong busy{0};
+        for (const auto &c : cpu_times) {
+            for (size_t i{0}; i < c.size(); i++) {
+                busy += i == 3 ? 0 : c[i];
+            }
+        }
+        return busy;
+    }
+
+    /// Advance the fake system by one second: CPU time passes, some processes exit and new ones start.
+    void tick() {
+        uptime += hz;
+
+        // Replace 'churn' of the processes.
+        const auto churn{static_cast<size_t>(static_cast<float>(procs.size()) * params.churn)};
+        for (size_t i{0}; i < churn && !procs.empty(); i++) {
+            const auto victim{random(procs.size())};
+            filesystem::remove_all(proc_dir(procs[victim]));
+            procs[victim] = procs.back();
+            procs.pop_back();
+        }
+        for (size_t i{0}; i < churn; i++) {
+            spawn();
+        }
+
+        // Each CPU is busy for a random part of the tick, in slices of up to a quarter of it that go to random
+        // processes. The times of the processes add up to those of the CPUs at any scale.
+        for (auto &c : cpu_times) {
+            auto busy{procs.empty() ? 0 : random(hz + 1)};
+            c[3] += hz - busy;
+            while (busy > 0) {
+                auto &p{procs[random(procs.size())]};
+                const auto slice{min(busy, 1 + random(hz / 4))};
+                const auto system{random(slice / 4 + 1)};
+                p.utime += slice - system;
+                p.stime += system;
+                c[0] += slice - system;
+                c[2] += system;
+                busy -= slice;
+            }
+        }
+        for (const auto &p : procs) {
+            write_stat(p);
+        }
+        write_system();
+    }
+};
+}; // namespace fprd
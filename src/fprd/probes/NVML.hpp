@@ -8,15 +8,23 @@
 
 #pragma once
 
-#include </opt/cuda/targets/x86_64-linux/include/nvml.h>
+#include <nvml.h>
 
+#include <algorithm>
 #include <condition_variable>
 #include <dbg/Log.hpp>
+#include <deque>
+#include <fprd/probes/Root.hpp>
 #include <fprd/probes/UNIX.hpp>
+#include <fprd/util/Allocations.hpp>
 #include <fprd/util/ostream.hpp>
+#include <fprd/util/TopK.hpp>
+#include <fprd/util/ranges.hpp>
 #include <fprd/util/time.hpp>
 #include <fprd/util/to_string.hpp>
+#include <functional>
 #include <mutex>
+#include <span>
 #include <thread>
 
 namespace fprd {
@@ -40,13 +48,42 @@ template <u_char max_procs> class Device {
     friend NVML;
 
   public:
+    /// What 'probe_data' asks the driver for.
+    /// 'process_utilization' needs 'processes' first.
+    enum class Query : u_char {
+        utilization,
+        memory,
+        fan,
+        temp,
+        power,
+        clock,
+        processes,
+        process_utilization,
+        count
+    };
+    static constexpr array<string_view, static_cast<size_t>(Query::count)> query_names{
+        "utilization", "memory", "fan", "temperature", "power", "clock", "processes", "process utilization"};
+
+    /// A set of queries.
+    struct Queries {
+        u_char bits{0};
+
+        /// @param q
+        /// @return bool
+        [[nodiscard]] bool has(Query q) const { return ((bits >> static_cast<u_char>(q)) & 1U) != 0; }
+        /// @param q
+        void add(Query q) { bits |= 1U << static_cast<u_char>(q); }
+    };
+
     /// Our representation of a process.
     struct Process {
         string name;
         nvmlProcessInfo_t t;
+        u_char sm; // % of the SMs, averaged since the previous probe.
 
-        static constexpr auto name_size{32};
+        static constexpr auto name_size{27};
         static constexpr auto pid_size{7};
+        static constexpr auto sm_size{4};
         static constexpr auto memory_size{8};
 
         static string header() {
@@ -55,11 +92,17 @@ template <u_char max_procs> class Device {
             os << " ";
             os << setfill(' ') << setw(name_size) << left << "Name";
             os << " ";
+            os << setfill(' ') << setw(sm_size) << right << "SM";
+            os << " ";
             os << setfill(' ') << setw(memory_size) << right << "Memory";
 
             return os.str();
         };
 
+        /// @param p
+        /// @return auto
+        static auto fields(auto &p) { return tie(p.name, p.t, p.sm); }
+
         bool operator==(const Process &rhs) const { return t.pid == rhs.t.pid; }
 
         ostream &print(ostream &os) const {
@@ -67,6 +110,8 @@ template <u_char max_procs> class Device {
             os << " ";
             os << setfill(' ') << setw(name_size) << left << truncs<name_size>(name);
             os << " ";
+            os << setfill(' ') << setw(sm_size) << right << (to_string(sm) + "%");
+            os << " ";
             os << setfill(' ') << setw(memory_size) << right << (ftos<0>(t.usedGpuMemory / 1000000.0F) + "MB");
             return os;
         };
@@ -80,19 +125,307 @@ template <u_char max_procs> class Device {
         u_char temp;               // Celsius
         float power;               // Watts
         ushort clock;              // MHz
+        float latency;             // ms. How long probing took.
+        ushort stale{0};           // Probes that the device missed in a row. The rest is meaningless if not 0.
+        Queries failed;            // Supported queries that failed in this probe. What they are about is 0.
+
+        /// %. Every utilization sample that the driver took since the previous probe, oldest first.
+        /// Empty if the driver does not keep samples.
+        vector<float> utilization_samples;
 
         /// Sorted list of processes.
         /// INFO: Maximum of 'max_procs' items shown.
         vector<Process> procs;
+
+        /// @param d
+        /// @return auto
+        static auto fields(auto &d) {
+            return tie(d.utilization, d.memory, d.utilization_memory, d.fan, d.temp, d.power, d.clock, d.latency,
+                       d.stale, d.failed, d.utilization_samples, d.procs);
+        }
+
+        /// Reset everything for the next probe, but keep the memory of the vectors.
+        /// 'procs' is kept as it is, for 'read_processes' to resize, so that the names keep their memory too.
+        void clear() {
+            auto samples{move(utilization_samples)};
+            auto ps{move(procs)};
+            *this = {};
+            samples.clear();
+            utilization_samples = move(samples);
+            procs = move(ps);
+        }
     };
 
   private:
+    /// A field of 'nvmlDeviceGetFieldValues'.
+    struct Field {
+        unsigned int id;
+        Query query;
+    };
+
+    /// Read together with a single 'nvmlDeviceGetFieldValues' request instead of one call each.
+    /// A query is read from the first of its fields that the driver supports. The averaged power is what
+    /// 'nvmlDeviceGetPowerUsage' reports on recent GPUs, so the values do not jump around more when batched.
+    /// NVML has fields for the limits of temperatures and clocks, but not for their current values, nor for memory
+    /// use, fan speed or utilization, so those always need their own calls.
+    static constexpr array<Field, 2> field_table{{
+        {NVML_FI_DEV_POWER_AVERAGE, Query::power},
+        {NVML_FI_DEV_POWER_INSTANT, Query::power},
+    }};
+
     /// The wrapped thing.
     nvmlDevice_t t;
+    /// '/proc/' under the probe root, for the names of the processes. Resolved when the device is created.
+    const string proc{probe_path("/proc/")};
+
+    /// The part of 'field_table' that the driver supports. Empty if it does not support field values at all.
+    vector<Field> batched;
+
+    /// The driver keeps about a second of utilization samples.
+    static constexpr auto max_samples{128};
+    /// The timestamp of the newest utilization sample that we have seen. Only touched by one probe at a time.
+    mutable unsigned long long last_sample{0};
+    /// False once the driver said that it does not keep samples.
+    mutable bool has_samples{true};
+
+    /// Reused by every probe, so that they are only allocated when they grow.
+    mutable vector<nvmlProcessInfo_t> graphics_buf = vector<nvmlProcessInfo_t>(16);
+    mutable vector<nvmlProcessInfo_t> compute_buf = vector<nvmlProcessInfo_t>(16);
+    mutable vector<nvmlProcessInfo_t> merged_buf = vector<nvmlProcessInfo_t>(32);
+    mutable vector<nvmlProcessUtilizationSample_t> utilization_buf = vector<nvmlProcessUtilizationSample_t>(64);
+    /// The timestamp of the newest process utilization sample that we have seen.
+    mutable unsigned long long last_process_sample{0};
+
+    /// @param r
+    /// @return bool True if 'r' says that the device will never answer the query.
+    static bool unsupported(nvmlReturn_t r) {
+        return r == NVML_ERROR_NOT_SUPPORTED || r == NVML_ERROR_NO_PERMISSION ||
+               r == NVML_ERROR_FUNCTION_NOT_FOUND;
+    }
+
+    /// Ask the driver for one thing, with its own call. What it is about is 0 if the call fails.
+    /// @param data
+    /// @param q
+    /// @return nvmlReturn_t
+    nvmlReturn_t read(DynamicData &data, Query q) const {
+        switch (q) {
+        case Query::utilization: {
+            nvmlUtilization_t u{};
+            const auto r{nvmlDeviceGetUtilizationRates(t, &u)};
+            data.utilization = u.gpu;
+            data.utilization_memory = u.memory;
+            return r;
+        }
+        case Query::memory: {
+            nvmlMemory_t m{};
+            const auto r{nvmlDeviceGetMemoryInfo(t, &m)};
+            data.memory = (float)m.used * 1e-9F;
+            return r;
+        }
+        case Query::fan: {
+            unsigned int s{0};
+            const auto r{nvmlDeviceGetFanSpeed(t, &s)};
+            data.fan = s;
+            return r;
+        }
+        case Query::temp: {
+            unsigned int temp{0};
+            const auto r{nvmlDeviceGetTemperature(t, NVML_TEMPERATURE_GPU, &temp)};
+            data.temp = temp;
+            return r;
+        }
+        case Query::power: {
+            unsigned int p{0};
+            const auto r{nvmlDeviceGetPowerUsage(t, &p)};
+            data.power = (float)p / 1000;
+            return r;
+        }
+        case Query::clock: {
+            unsigned int c{0};
+            const auto r{nvmlDeviceGetClockInfo(t, NVML_CLOCK_GRAPHICS, &c)};
+            data.clock = c;
+            return r;
+        }
+        case Query::processes:
+            return read_processes(data.procs);
+        case Query::process_utilization:
+            return read_process_utilization(data.procs);
+        case Query::count:
+            break;
+        }
+        return NVML_ERROR_INVALID_ARGUMENT;
+    }
+
+    /// Read a list from NVML into 'buf'. 'buf' grows to the size that NVML asks for, and never shrinks.
+    /// @tparam T
+    /// @tparam F
+    /// @param buf
+    /// @param f Called as 'f(unsigned int *count, T *buf)', like the NVML functions for lists.
+    /// @param r What NVML returned.
+    /// @return span<const T> What was read. Empty on errors.
+    template <class T, class F> static span<const T> read_list(vector<T> &buf, F f, nvmlReturn_t &r) {
+        // Two tries, because the list can grow between the calls.
+        for (auto i{0}; i < 2; i++) {
+            auto count{static_cast<unsigned int>(buf.size())};
+            r = f(&count, buf.data());
+            if (r == NVML_SUCCESS) {
+                return {buf.data(), count};
+            }
+            if (r != NVML_ERROR_INSUFFICIENT_SIZE) {
+                break;
+            }
+            buf.resize(count + count / 2 + 1);
+        }
+        return {};
+    }
+
+    /// Graphics and compute processes, merged by PID.
+    /// A list that the device does not have counts as empty, unless it has neither.
+    /// @param procs The top 'max_procs' by memory usage.
+    /// @return nvmlReturn_t An error if either list failed. 'procs' then only has the processes of the other one.
+    nvmlReturn_t read_processes(vector<Process> &procs) const {
+        nvmlReturn_t rg;
+        nvmlReturn_t rc;
+        const auto graphics{read_list(
+            graphics_buf, [this](auto *c, auto *b) { return nvmlDeviceGetGraphicsRunningProcesses_v2(t, c, b); },
+            rg)};
+        const auto compute{read_list(
+            compute_buf, [this](auto *c, auto *b) { return nvmlDeviceGetComputeRunningProcesses_v2(t, c, b); },
+            rc)};
+
+        static constexpr auto by_memory{[](const nvmlProcessInfo_t &p) { return p.usedGpuMemory; }};
+        TopK<nvmlProcessInfo_t, max_procs, decltype(by_memory)> top;
+        merged_buf.assign(graphics.begin(), graphics.end());
+        merged_buf.insert(merged_buf.end(), compute.begin(), compute.end());
+        sort(merged_buf.begin(), merged_buf.end(), [](auto &a, auto &b) { return a.pid < b.pid; });
+        // A process that does both is in both lists. It is shown once, with the larger of its two memory usages.
+        for (auto i{merged_buf.begin()}; i != merged_buf.end();) {
+            auto p{*i};
+            for (i++; i != merged_buf.end() && i->pid == p.pid; i++) {
+                p.usedGpuMemory = max(p.usedGpuMemory, i->usedGpuMemory);
+            }
+            top.push(p);
+        }
+
+        // Sorted by memory usage. Assigned in place, so that the names keep their memory.
+        const auto sorted{top.sorted()};
+        procs.resize(sorted.size());
+        for (size_t i{0}; i < sorted.size(); i++) {
+            get_name(proc, sorted[i].pid, procs[i].name);
+            procs[i].t = sorted[i];
+            procs[i].sm = 0;
+        }
+        if (unsupported(rg) && unsupported(rc)) {
+            return rg;
+        }
+        for (const auto r : {rg, rc}) {
+            if (r != NVML_SUCCESS && !unsupported(r)) {
+                return r;
+            }
+        }
+        return NVML_SUCCESS;
+    }
+
+    /// Fill in the SM utilization of 'procs', from the samples since the previous call.
+    /// @param procs
+    /// @return nvmlReturn_t
+    nvmlReturn_t read_process_utilization(vector<Process> &procs) const {
+        nvmlReturn_t r;
+        const auto samples{read_list(
+            utilization_buf,
+            [this](auto *c, auto *b) { return nvmlDeviceGetProcessUtilization(t, b, c, last_process_sample); },
+            r)};
+        // NOT_FOUND means no new samples, i.e. the processes were idle.
+        if (r == NVML_ERROR_NOT_FOUND) {
+            return NVML_SUCCESS;
+        }
+        for (auto &p : procs) {
+            unsigned int sum{0};
+            unsigned int n{0};
+            for (const auto &s : samples) {
+                if (s.pid == p.t.pid) {
+                    sum += s.smUtil;
+                    n++;
+                }
+            }
+            p.sm = n == 0 ? 0 : static_cast<u_char>(min(sum / n, 100U));
+        }
+        for (const auto &s : samples) {
+            last_process_sample = max(last_process_sample, s.timeStamp);
+        }
+        return r;
+    }
+
+    /// Store a query read as a field.
+    /// @param data
+    /// @param q
+    /// @param v
+    static void store(DynamicData &data, Query q, const nvmlFieldValue_t &v) {
+        switch (q) {
+        case Query::power:
+            data.power = static_cast<float>(v.value.uiVal) / 1000; // mW
+            break;
+        default:
+            break;
+        }
+    }
+
+    /// Get the utilization samples since the previous call, in a single request.
+    /// @param samples
+    void read_samples(vector<float> &samples) const {
+        if (!has_samples) {
+            return;
+        }
+        array<nvmlSample_t, max_samples> buf;
+        nvmlValueType_t type;
+        unsigned int count{buf.size()};
+        const auto r{
+            nvmlDeviceGetSamples(t, NVML_GPU_UTILIZATION_SAMPLES, last_sample, &type, &count, buf.data())};
+        if (r == NVML_ERROR_NOT_SUPPORTED) {
+            has_samples = false;
+            return;
+        }
+        // NOT_FOUND means no new samples.
+        if (r != NVML_SUCCESS) {
+            return;
+        }
+        const auto value{[type](const nvmlValue_t &v) -> float {
+            switch (type) {
+            case NVML_VALUE_TYPE_DOUBLE:
+                return static_cast<float>(v.dVal);
+            case NVML_VALUE_TYPE_UNSIGNED_LONG:
+                return static_cast<float>(v.ulVal);
+            case NVML_VALUE_TYPE_UNSIGNED_LONG_LONG:
+                return static_cast<float>(v.ullVal);
+            case NVML_VALUE_TYPE_SIGNED_LONG_LONG:
+                return static_cast<float>(v.sllVal);
+            default:
+                return static_cast<float>(v.uiVal);
+            }
+        }};
+        // The driver does not promise any order.
+        sort(buf.begin(), buf.begin() + count, [](auto &a, auto &b) { return a.timeStamp < b.timeStamp; });
+        for (const auto &s : span{buf.data(), count}) {
+            if (s.timeStamp > last_sample) {
+                samples.push_back(value(s.sampleValue));
+            }
+        }
+        if (count > 0) {
+            last_sample = max(last_sample, buf[count - 1].timeStamp);
+        }
+    }
+
+    /// @param fs
+    /// @return bool True if the field values were read. Each one still has its own 'nvmlReturn'.
+    bool read_fields(span<nvmlFieldValue_t> fs) const {
+        return nvmlDeviceGetFieldValues(t, static_cast<int>(fs.size()), fs.data()) == NVML_SUCCESS;
+    }
 
   public:
     const string name;        // Product name
     const float memory_total; // GB
+    /// Found out once, here. The rest are never asked for.
+    const Queries supported;
 
     Device(nvmlDevice_t t)
         : t{t}, name{[t]() -> string {
@@ -101,74 +434,146 @@ template <u_char max_procs> class Device {
               return buf.data();
           }()},
           memory_total{[t]() -> float {
-              nvmlMemory_t m;
-              check(nvmlDeviceGetMemoryInfo(t, &m));
+              nvmlMemory_t m{};
+              nvmlDeviceGetMemoryInfo(t, &m);
               return static_cast<float>((float)m.total * 1e-9);
-          }()} {}
+          }()},
+          supported{[this] {
+              Queries qs;
+              DynamicData scratch{};
+              for (u_char i{0}; i < static_cast<u_char>(Query::count); i++) {
+                  const Query q{i};
+                  if (const auto r{read(scratch, q)}; unsupported(r)) {
+                      dbg_out(name << ": " << query_names[i] << " unavailable: " << nvmlErrorString(r));
+                  } else {
+                      qs.add(q);
+                  }
+              }
+              return qs;
+          }()} {
+        array<nvmlFieldValue_t, field_table.size()> fs{};
+        for (auto [f, id] : zip(fs, field_table)) {
+            f.fieldId = id.id;
+        }
+        if (!read_fields(fs)) {
+            return;
+        }
+        for (auto [f, id] : zip(fs, field_table)) {
+            if (f.nvmlReturn == NVML_SUCCESS && supported.has(id.query) &&
+                none_of(batched.begin(), batched.end(), [&id](const Field &b) { return b.query == id.query; })) {
+                batched.push_back(id);
+            }
+        }
+    }
 
     Device(const Device &) = delete;
     Device(Device &&) noexcept = default;
 
+    /// What an event told about the device.
+    struct Alert {
+        string text;           // Empty if there is nothing to warn about.
+        unsigned int clock{0}; // MHz. The graphics clock after a clock change, else 0.
+    };
+
+    /// The events that are worth an 'Alert'.
+    static constexpr unsigned long long alert_events{nvmlEventTypeXidCriticalError | nvmlEventTypeClock |
+                                                     nvmlEventTypePState};
+
+    /// Ask for the 'alert_events' that the device has, into 'set'.
+    /// @param set
+    /// @return bool False if it has none of them.
+    bool register_events(nvmlEventSet_t set) const {
+        unsigned long long types{0};
+        if (const auto r{nvmlDeviceGetSupportedEventTypes(t, &types)}; r != NVML_SUCCESS) {
+            dbg_out(name << ": no events: " << nvmlErrorString(r));
+            return false;
+        }
+        types &= alert_events;
+        if (types == 0) {
+            return false;
+        }
+        if (const auto r{nvmlDeviceRegisterEvents(t, types, set)}; r != NVML_SUCCESS) {
+            dbg_out(name << ": no events: " << nvmlErrorString(r));
+            return false;
+        }
+        return true;
+    }
+
+    /// @param handle
+    /// @return bool True if 'handle' is this device, e.g. in 'nvmlEventData_t'.
+    [[nodiscard]] bool is(nvmlDevice_t handle) const { return handle == t; }
+
+    /// Read what changed right away, while it is still the case.
+    /// @param e An event of this device.
+    /// @return Alert
+    [[nodiscard]] Alert describe(const nvmlEventData_t &e) const {
+        Alert a;
+        if ((e.eventType & nvmlEventTypeXidCriticalError) != 0) {
+            a.text = "XID " + to_string(e.eventData);
+        }
+        if ((e.eventType & nvmlEventTypeClock) != 0) {
+            nvmlDeviceGetClockInfo(t, NVML_CLOCK_GRAPHICS, &a.clock);
+            constexpr auto thermal{nvmlClocksThrottleReasonHwThermalSlowdown |
+                                   nvmlClocksThrottleReasonSwThermalSlowdown};
+            constexpr auto power{nvmlClocksThrottleReasonHwPowerBrakeSlowdown |
+                                 nvmlClocksThrottleReasonSwPowerCap};
+            unsigned long long reasons{0};
+            nvmlDeviceGetCurrentClocksThrottleReasons(t, &reasons);
+            if ((reasons & thermal) != 0) {
+                a.text = "Throttled: thermal";
+            } else if ((reasons & power) != 0) {
+                a.text = "Throttled: power";
+            } else if ((reasons & nvmlClocksThrottleReasonHwSlowdown) != 0) {
+                a.text = "Throttled: hardware";
+            }
+        }
+        if ((e.eventType & nvmlEventTypePState) != 0) {
+            if (nvmlPstates_t p; nvmlDeviceGetPerformanceState(t, &p) == NVML_SUCCESS) {
+                a.text = "P-state P" + to_string(p);
+            }
+        }
+        return a;
+    }
+
     /// Update mutable data for this device.
-    [[nodiscard]] DynamicData probe_data() const {
-        dbg(auto tp{now()});
-
-        DynamicData data;
-        tie(data.utilization, data.utilization_memory) = [this]() {
-            nvmlUtilization_t u;
-            check(nvmlDeviceGetUtilizationRates(t, &u));
-            return make_pair(u.gpu, u.memory);
-        }();
-        data.memory = [this]() {
-            nvmlMemory_t m;
-            check(nvmlDeviceGetMemoryInfo(t, &m));
-            return (float)m.used * 1e-9;
-        }();
-        data.fan = [this]() {
-            unsigned int s;
-            check(nvmlDeviceGetFanSpeed(t, &s));
-            return s;
-        }();
-        data.temp = [this]() {
-            unsigned int temp;
-            check(nvmlDeviceGetTemperature(t, NVML_TEMPERATURE_GPU, &temp));
-            return temp;
-        }();
-        data.power = [this]() {
-            unsigned int p;
-            check(nvmlDeviceGetPowerUsage(t, &p));
-            return (float)p / 1000;
-        }();
-        data.clock = [this]() {
-            unsigned int c;
-            check(nvmlDeviceGetClockInfo(t, NVML_CLOCK_GRAPHICS, &c));
-            return c;
-        }();
-        data.procs = [this]() {
-            const auto procs{[this]() {
-                auto procs{[this]() -> vector<nvmlProcessInfo_t> {
-                    array<nvmlProcessInfo_t, 16> i;
-                    unsigned int c{i.size()};
-                    check(nvmlDeviceGetGraphicsRunningProcesses_v2(t, &c, i.data()));
-
-                    sort(i.begin(), i.begin() + c,
-                         [](auto &l, auto &r) { return l.usedGpuMemory > r.usedGpuMemory; });
-                    if (c > max_procs) {
-                        return {i.begin(), i.begin() + max_procs};
+    /// Only asks for what the device supports. Other failures are transient (e.g. while the driver is busy), and
+    /// leave the value at 0 for this probe.
+    /// @param data Overwritten. Pass the same one again and again, so that its memory is reused.
+    void probe_data(DynamicData &data) const {
+        const auto tp{now()};
+
+        data.clear();
+        // What the fields have, does not need calls of its own.
+        Queries done;
+        if (!batched.empty()) {
+            array<nvmlFieldValue_t, field_table.size()> fs{};
+            for (size_t i{0}; i < batched.size(); i++) {
+                fs[i].fieldId = batched[i].id;
+            }
+            const span requested{fs.data(), batched.size()};
+            if (read_fields(requested)) {
+                for (auto i{0U}; i < requested.size(); i++) {
+                    if (requested[i].nvmlReturn == NVML_SUCCESS) {
+                        store(data, batched[i].query, requested[i]);
+                        done.add(batched[i].query);
                     }
-                    return {i.begin(), i.begin() + c};
-                }()};
-                return procs;
-            }()};
-            vector<Process> ps;
-            ps.reserve(ps.size());
-            for (auto p : procs) {
-                ps.emplace_back(Process{get_name(p.pid), p});
-            }
-            return ps;
-        }();
-        dbg_out("GPU data: " << diff(tp) << "ms");
-        return data;
+                }
+            }
+        }
+        for (u_char i{0}; i < static_cast<u_char>(Query::count); i++) {
+            const Query q{i};
+            if (!supported.has(q) || done.has(q)) {
+                continue;
+            }
+            if (const auto r{read(data, q)}; r != NVML_SUCCESS) {
+                dbg_out(name << ": " << query_names[i] << " failed: " << nvmlErrorString(r));
+                data.failed.add(q);
+            }
+        }
+        read_samples(data.utilization_samples);
+
+        data.latency = duration<float, milli>(now() - tp).count();
+        dbg_out("GPU data: " << data.latency << "ms, batched fields: " << batched.size());
     }
 };
 
@@ -199,5 +604,167 @@ struct NVML {
     }
 };
 
+/// Waits for the events of the devices on a thread of its own, and calls back as soon as one arrives.
+/// Does nothing if no device has any of 'Device::alert_events'.
+/// @tparam max_procs
+template <u_char max_procs> class Events {
+    /// How long a wait may take, i.e. how long stopping may take.
+    static constexpr auto wait_timeout{250ms};
+
+    const vector<Device<max_procs>> &devices;
+    nvmlEventSet_t set{nullptr};
+    atomic<bool> stopping{false};
+    thread waiter;
+
+  public:
+    /// Called on the thread of 'Events', with the index of the device.
+    using Handler = function<void(size_t, typename Device<max_procs>::Alert)>;
+
+    /// @param devices Must outlive this.
+    /// @param f
+    Events(const vector<Device<max_procs>> &devices, Handler f) : devices{devices} {
+        if (const auto r{nvmlEventSetCreate(&set)}; r != NVML_SUCCESS) {
+            dbg_out("No GPU events: " << nvmlErrorString(r));
+            return;
+        }
+        if (count_if(devices.begin(), devices.end(), [this](auto &d) { return d.register_events(set); }) == 0) {
+            return;
+        }
+        waiter = thread{[this, f = move(f)] {
+            while (!stopping) {
+                nvmlEventData_t e{};
+                const auto r{nvmlEventSetWait_v2(set, &e, duration_cast<milliseconds>(wait_timeout).count())};
+                if (r == NVML_ERROR_TIMEOUT) {
+                    continue;
+                }
+                if (r != NVML_SUCCESS) {
+                    dbg_out("GPU events failed: " << nvmlErrorString(r));
+                    return;
+                }
+                for (size_t i{0}; i < this->devices.size(); i++) {
+                    if (this->devices[i].is(e.device)) {
+                        f(i, this->devices[i].describe(e));
+                    }
+                }
+            }
+        }};
+    }
+    /// Copying is not allowed.
+    Events(const Events &) = delete;
+
+    ~Events() {
+        stopping = true;
+        if (waiter.joinable()) {
+            waiter.join();
+        }
+        if (set != nullptr) {
+            nvmlEventSetFree(set);
+        }
+    }
+};
+
+/// Probes devices concurrently on a few threads, so that a slow device does not hold up the others.
+/// @tparam max_procs
+template <u_char max_procs> class Prober {
+    using DynamicData = typename Device<max_procs>::DynamicData;
+
+    /// The state of a device.
+    struct Slot {
+        DynamicData last{}; // From the latest probe that finished, until 'probe_all' takes it.
+        DynamicData next{}; // Only touched by the probe that is running. Swapped with 'last' when it finishes.
+        bool busy{false};   // A probe is queued or running.
+        bool fresh{false};  // 'last' is new since the previous 'probe_all'.
+        ushort missed{0};   // 'probe_all' calls in a row that found nothing new.
+    };
+
+    const vector<Device<max_procs>> &devices;
+
+    mutex m;
+    condition_variable work;
+    condition_variable done;
+    /// Devices waiting for a thread.
+    deque<size_t> queue;
+    vector<Slot> slots;
+    bool stopping{false};
+    vector<thread> workers;
+
+    void run() {
+        unique_lock lk{m};
+        while (true) {
+            work.wait(lk, [this] { return stopping || !queue.empty(); });
+            if (stopping) {
+                return;
+            }
+            const auto i{queue.front()};
+            queue.pop_front();
+
+            lk.unlock();
+            const auto allocations{allocation_count()};
+            devices[i].probe_data(slots[i].next);
+            if (const auto n{allocation_count() - allocations}; n != 0) {
+                cerr << devices[i].name << ": probe allocated " << n << " times" << endl;
+            }
+            lk.lock();
+
+            swap(slots[i].last, slots[i].next);
+            slots[i].busy = false;
+            slots[i].fresh = true;
+            done.notify_one();
+        }
+    }
+
+  public:
+    /// @param devices Must outlive this.
+    /// @param threads
+    Prober(const vector<Device<max_procs>> &devices, size_t threads) : devices{devices}, slots(devices.size()) {
+        for (size_t i{0}; i < min(threads, devices.size()); i++) {
+            workers.emplace_back([this] { run(); });
+        }
+    }
+    /// Copying is not allowed.
+    Prober(const Prober &) = delete;
+
+    /// Waits for the probes that are running, which cannot be cancelled.
+    ~Prober() {
+        {
+            lock_guard lg{m};
+            stopping = true;
+        }
+        work.notify_all();
+        for (auto &w : workers) {
+            w.join();
+        }
+    }
+
+    /// Probe every device that is not still busy with an earlier probe, and wait for them until 'deadline'.
+    /// @param deadline
+    /// @param data Of each device. For devices that missed the deadline, only 'stale' is set, to the number of
+    /// probes that they missed. Their probe still finishes in the background. The new data is swapped in, and the
+    /// probes reuse the memory of what was there.
+    void probe_all(time_point<high_resolution_clock> deadline, vector<DynamicData> &data) {
+        unique_lock lk{m};
+        for (size_t i{0}; i < slots.size(); i++) {
+            if (!slots[i].busy) {
+                slots[i].busy = true;
+                queue.push_back(i);
+            }
+        }
+        work.notify_all();
+        done.wait_until(lk, deadline,
+                        [this] { return none_of(slots.begin(), slots.end(), [](auto &s) { return s.busy; }); });
+
+        data.resize(slots.size());
+        for (auto [s, d] : zip(slots, data)) {
+            if (s.fresh) {
+                s.fresh = false;
+                s.missed = 0;
+                swap(s.last, d);
+            } else {
+                s.missed++;
+            }
+            d.stale = s.missed;
+        }
+    }
+};
 }; // namespace nvml
 }; // namespace fprd
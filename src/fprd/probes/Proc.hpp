@@ -0,0 +1,104 @@
+/// @file Proc.hpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+
+#pragma once
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <dbg/Log.hpp>
+#include <fprd/probes/Root.hpp>
+#include <fprd/probes/UNIX.hpp>
+#include <fprd/util/file.hpp>
+#include <string>
+#include <vector>
+
+namespace fprd {
+using namespace ::std;
+
+/// Walks the processes in '/proc'.
+/// '/proc' stays open and is listed with 'getdents64' into one large buffer, so a walk costs a handful of
+/// syscalls no matter how many processes there are. No 'directory_entry', path or string is created: the PID is
+/// parsed from the raw entry name and the per-process files are opened relative to the directory.
+/// This is the base for all probes that look at processes.
+class ProcDir {
+    /// '/proc'
+    int fd;
+    /// Raw 'dirent64' records.
+    vector<byte> buf;
+
+  public:
+    /// @param path
+    ProcDir(const string &path = probe_path("/proc"))
+        : fd{::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)}, buf(1 << 16) {
+        if (fd < 0) {
+            fatal_error("Failed to open " << path);
+        }
+    }
+    /// Copying is not allowed.
+    ProcDir(const ProcDir &) = delete;
+
+    ~ProcDir() { ::close(fd); }
+
+    /// @return int The fd of the directory, for opening files relative to it.
+    [[nodiscard]] int handle() const { return fd; }
+
+    /// Call 'f(pid)' for every process.
+    /// @tparam F
+    /// @param f
+    template <class F> void for_each_pid(F f) {
+        ::lseek(fd, 0, SEEK_SET);
+        while (true) {
+            const auto n{::getdents64(fd, buf.data(), buf.size())};
+            if (n <= 0) {
+                return;
+            }
+            for (ssize_t off{0}; off < n;) {
+                const auto *const d{reinterpret_cast<const dirent64 *>(buf.data() + off)};
+                off += d->d_reclen;
+
+                if (d->d_type != DT_DIR && d->d_type != DT_UNKNOWN) {
+                    continue;
+                }
+                // Skip directories that are not PIDs (number).
+                pid_t pid{0};
+                const char *c{d->d_name};
+                for (; '0' <= *c && *c <= '9'; c++) {
+                    pid = pid * 10 + (*c - '0');
+                }
+                if (c == d->d_name || *c != '\0') {
+                    continue;
+                }
+                f(pid);
+            }
+        }
+    }
+
+    /// A process whose main thread exited stays, as a zombie, while its other threads run.
+    /// @param pid
+    /// @return bool True if threads other than the main one still run. False if the process is gone.
+    [[nodiscard]] bool has_other_threads(pid_t pid) const {
+        struct stat st {};
+        // The links of 'task' are '.', the parent, and one per thread that is not released yet.
+        return ::fstatat(fd, pid_path("", pid, "task").data(), &st, 0) == 0 && st.st_nlink > 3;
+    }
+
+    /// Read '<pid>/<file>' into a stack buffer.
+    /// @tparam size
+    /// @param pid
+    /// @param file
+    /// @param buf
+    /// @return string_view Same as 'read_file'.
+    template <size_t size> string_view read(pid_t pid, string_view file, array<char, size> &buf) const {
+        return read_file_at(fd, pid_path("", pid, file).data(), buf);
+    }
+};
+}; // namespace fprd
@@ -0,0 +1,210 @@
+/// @file ProcEvents.hpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+
+#pragma once
+
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <dbg/Log.hpp>
+#include <fprd/Config.hpp>
+#include <fprd/probes/Proc.hpp>
+#include <fprd/probes/Root.hpp>
+#include <fprd/util/HashMap.hpp>
+#include <fprd/util/time.hpp>
+
+namespace fprd {
+using namespace ::std;
+
+/// Fork/exit notifications from the kernel's netlink proc connector.
+/// Subscribing needs CAP_NET_ADMIN. Check 'valid' before using it.
+class ProcConnector {
+    /// The netlink socket. Negative if unavailable.
+    int fd;
+
+    /// Subscribe or unsubscribe.
+    /// @param op
+    /// @return bool
+    bool send_op(proc_cn_mcast_op op) {
+        // nlmsghdr + cn_msg + op, laid out by hand since 'cn_msg' ends with a flexible array.
+        alignas(nlmsghdr) array<byte, NLMSG_SPACE(sizeof(cn_msg) + sizeof(op))> msg{};
+        auto *const nl{reinterpret_cast<nlmsghdr *>(msg.data())};
+        nl->nlmsg_len = NLMSG_LENGTH(sizeof(cn_msg) + sizeof(op));
+        nl->nlmsg_type = NLMSG_DONE;
+        nl->nlmsg_pid = ::getpid();
+        auto *const cn{static_cast<cn_msg *>(NLMSG_DATA(nl))};
+        cn->id.idx = CN_IDX_PROC;
+        cn->id.val = CN_VAL_PROC;
+        cn->len = sizeof(op);
+        memcpy(cn->data, &op, sizeof(op));
+        return ::send(fd, msg.data(), nl->nlmsg_len, 0) >= 0;
+    }
+
+  public:
+    /// What we care about.
+    enum class Event : u_char {
+        fork,        // A new process (not a thread).
+        exit,        // The main thread of a process exited. Its other threads may still run.
+        thread_exit, // Another thread exited. The pid is that of its process.
+    };
+
+    // The events are about the running kernel, so they are useless for a fake tree.
+    ProcConnector()
+        : fd{is_live_system() ? ::socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR)
+                              : -1} {
+        if (fd < 0) {
+            return;
+        }
+        sockaddr_nl addr{};
+        addr.nl_family = AF_NETLINK;
+        addr.nl_groups = CN_IDX_PROC;
+        addr.nl_pid = 0; // Let the kernel pick.
+        // Fails with EPERM without CAP_NET_ADMIN.
+        if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+            !send_op(PROC_CN_MCAST_LISTEN)) {
+            dbg_out("Proc connector unavailable: " << strerror(errno));
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    /// Copying is not allowed.
+    ProcConnector(const ProcConnector &) = delete;
+
+    ~ProcConnector() {
+        if (fd >= 0) {
+            send_op(PROC_CN_MCAST_IGNORE);
+            ::close(fd);
+        }
+    }
+
+    /// @return bool True if we are receiving events.
+    [[nodiscard]] bool valid() const { return fd >= 0; }
+
+    /// Handle every pending event without blocking.
+    /// @tparam F
+    /// @param f Called as 'f(Event, pid)'.
+    /// @return bool False if events were lost (the socket buffer overflowed). Rescan if so.
+    template <class F> bool drain(F f) {
+        alignas(nlmsghdr) array<byte, 1 << 16> buf;
+        while (true) {
+            const auto n{::recv(fd, buf.data(), buf.size(), 0)};
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return errno != ENOBUFS;
+            }
+            auto len{static_cast<unsigned int>(n)};
+            for (auto *nl{reinterpret_cast<nlmsghdr *>(buf.data())}; NLMSG_OK(nl, len); nl = NLMSG_NEXT(nl, len)) {
+                const auto *const cn{static_cast<const cn_msg *>(NLMSG_DATA(nl))};
+                if (cn->id.idx != CN_IDX_PROC || cn->id.val != CN_VAL_PROC) {
+                    continue;
+                }
+                const auto *const ev{reinterpret_cast<const proc_event *>(cn->data)};
+                switch (ev->what) {
+                case proc_event::PROC_EVENT_FORK:
+                    if (ev->event_data.fork.child_pid == ev->event_data.fork.child_tgid) {
+                        f(Event::fork, ev->event_data.fork.child_tgid);
+                    }
+                    break;
+                case proc_event::PROC_EVENT_EXIT:
+                    f(ev->event_data.exit.process_pid == ev->event_data.exit.process_tgid ? Event::exit
+                                                                                           : Event::thread_exit,
+                      ev->event_data.exit.process_tgid);
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+    }
+};
+
+/// Keeps the set of live processes.
+/// With the proc connector, the set is updated from fork/exit events and '/proc' is only listed every
+/// 'proc_rescan_interval' as a consistency check. Without it, '/proc' is listed every time.
+class ProcessTracker {
+    ProcDir proc_dir;
+    ProcConnector events;
+
+    /// The live processes. True if the main thread exited, and the process lives on in its other threads.
+    HashMap<pid_t, bool, IntHash> live;
+
+    /// @param pid Its main thread exited, or another thread of a process whose main thread exited before.
+    void on_exit(pid_t pid) {
+        if (proc_dir.has_other_threads(pid)) {
+            live.try_emplace(pid).first = true;
+        } else {
+            live.erase(pid);
+        }
+    }
+
+    /// When '/proc' was last listed.
+    decltype(now()) last_scan{};
+    /// Set when events were lost.
+    bool must_rescan{true};
+
+  public:
+    ProcessTracker() = default;
+    /// Copying is not allowed.
+    ProcessTracker(const ProcessTracker &) = delete;
+
+    /// @return const ProcDir& For reading the per-process files.
+    [[nodiscard]] const ProcDir &dir() const { return proc_dir; }
+
+    /// @return bool True if processes are tracked from events.
+    [[nodiscard]] bool event_driven() const { return events.valid(); }
+
+    /// Call 'f(pid)' for every live process.
+    /// @tparam F
+    /// @param f
+    template <class F> void for_each_pid(F f) {
+        if (!events.valid()) {
+            proc_dir.for_each_pid(f);
+            return;
+        }
+
+        // Apply the events first, so that events that arrive during a rescan are not lost.
+        if (!events.drain([this](ProcConnector::Event e, pid_t pid) {
+                switch (e) {
+                case ProcConnector::Event::fork:
+                    live.try_emplace(pid);
+                    break;
+                case ProcConnector::Event::exit:
+                    on_exit(pid);
+                    break;
+                case ProcConnector::Event::thread_exit:
+                    // Most threads belong to processes whose main thread is running.
+                    if (const auto *const leader_exited{live.find(pid)};
+                        leader_exited != nullptr && *leader_exited) {
+                        on_exit(pid);
+                    }
+                    break;
+                }
+            })) {
+            dbg_out("Proc connector overflowed. Rescanning.");
+            must_rescan = true;
+        }
+
+        if (must_rescan || now() - last_scan >= proc_rescan_interval) {
+            live.clear();
+            proc_dir.for_each_pid([this](pid_t pid) { live.try_emplace(pid); });
+            last_scan = now();
+            must_rescan = false;
+        }
+
+        live.for_each([&f](pid_t pid, bool /* leader_exited */) { f(pid); });
+    }
+};
+}; // namespace fprd
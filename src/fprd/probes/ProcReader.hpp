@@ -0,0 +1,233 @@
+/// @file ProcReader.hpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fprd/probes/Proc.hpp>
+#include <fprd/probes/UNIX.hpp>
+#include <fprd/util/HashMap.hpp>
+#include <fprd/util/IoUring.hpp>
+#include <iostream>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace fprd {
+using namespace ::std;
+
+/// Reads '<pid>/stat' of many processes at once.
+/// With io_uring, the reads for up to 'chunk' processes go to the kernel in a single syscall. The stat file of a
+/// process is opened once, directly into io_uring's fixed file table, and kept open for as long as the process is
+/// read every tick. After the first tick, reading a process is a single READ request instead of open + read +
+/// close.
+/// Without io_uring, the files are read one by one.
+class ProcStatReader {
+    /// Processes per submission, at most.
+    static constexpr unsigned batch{256};
+    /// Below this many processes per submission, batching is not worth a fixed file table.
+    static constexpr unsigned min_batch{16};
+    /// Per process. Same as the stack buffer used by the synchronous path.
+    static constexpr size_t buf_size{1024};
+
+    /// What a completion is for. Stored in the low bit of 'user_data'.
+    enum Op : u_char {
+        open,
+        read,
+    };
+
+    /// A stat file that is kept open.
+    struct OpenFile {
+        unsigned slot; // Index in the fixed file table.
+        uint tick;     // The last tick that read it.
+    };
+
+    const ProcDir &dir;
+    IoUring ring;
+    /// False if io_uring or one of the features we need is unavailable.
+    bool batched;
+    /// Processes per submission. Less than 'batch' if RLIMIT_NOFILE is low.
+    unsigned chunk{batch};
+    /// Whether 'bufs' is registered, so that reads can skip mapping the pages.
+    bool fixed_bufs{false};
+    /// 'chunk' buffers of 'buf_size' bytes each.
+    vector<char> bufs;
+    /// Paths of the files being opened. They must stay alive until the requests complete.
+    vector<array<char, 64>> paths;
+    /// The stat files that are kept open, by PID.
+    HashMap<pid_t, OpenFile, IntHash> open_files;
+    /// Unused slots for 'open_files'.
+    vector<unsigned> free_slots;
+    /// Slots after this are for one-off reads when every other slot is in use.
+    unsigned persistent_slots{0};
+    /// Counts calls to 'read_all'. Files not read in the latest tick belong to processes that are gone.
+    uint tick{0};
+    /// For the synchronous path.
+    array<char, buf_size> sync_buf;
+
+    /// Queue the requests for reading the 'k'-th process of a batch.
+    /// @param k
+    /// @param pid
+    /// @return unsigned The number of queued requests.
+    unsigned queue(unsigned k, pid_t pid) {
+        unsigned slot;
+        unsigned requests{1};
+        if (auto *const o{open_files.find(pid)}; o != nullptr) {
+            slot = o->slot;
+            o->tick = tick;
+        } else {
+            if (!free_slots.empty()) {
+                slot = free_slots.back();
+                free_slots.pop_back();
+                open_files.try_emplace(pid).first = {slot, tick};
+            } else {
+                slot = persistent_slots + k;
+            }
+            // Opening into an occupied slot replaces the file in it.
+            paths[k] = pid_path("", pid, "stat");
+            auto *const sqe{ring.get_sqe()};
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = dir.handle();
+            sqe->addr = reinterpret_cast<__u64>(paths[k].data());
+            // No O_CLOEXEC: direct descriptors are never inherited, and the kernel rejects it.
+            sqe->open_flags = O_RDONLY;
+            sqe->file_index = slot + 1;
+            // The read below is cancelled if this fails.
+            sqe->flags = IOSQE_IO_LINK;
+            sqe->user_data = k << 1U | Op::open;
+            requests++;
+        }
+
+        auto *const sqe{ring.get_sqe()};
+        sqe->opcode = fixed_bufs ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe->flags = IOSQE_FIXED_FILE;
+        sqe->fd = static_cast<int>(slot);
+        sqe->addr = reinterpret_cast<__u64>(&bufs[k * buf_size]);
+        sqe->len = buf_size;
+        sqe->off = 0;
+        sqe->buf_index = 0;
+        sqe->user_data = k << 1U | Op::read;
+        return requests;
+    }
+
+    /// Forget the open file of a process.
+    /// The file itself stays in the table until the slot is reused.
+    /// @param pid
+    void drop(pid_t pid) {
+        if (const auto *const o{open_files.find(pid)}; o != nullptr) {
+            free_slots.push_back(o->slot);
+            open_files.erase(pid);
+        }
+    }
+
+  public:
+    /// @param dir
+    /// @param shares The number of readers that share RLIMIT_NOFILE.
+    /// @param use_io_uring False to always read the files one by one, e.g. to compare against.
+    ProcStatReader(const ProcDir &dir, unsigned shares = 1, bool use_io_uring = true)
+        : dir{dir}, ring{batch * 2}, batched{use_io_uring && ring.valid()} {
+        if (!use_io_uring) {
+            return;
+        }
+        if (!batched) {
+            cerr << "Batched /proc reads disabled: io_uring is unavailable." << endl;
+            return;
+        }
+        // Direct descriptors do not use up normal fds, but the files are still open. The readers split
+        // RLIMIT_NOFILE between them, so that all of them together keep at most that many files open.
+        rlimit nofile{};
+        ::getrlimit(RLIMIT_NOFILE, &nofile);
+        const auto slots{static_cast<unsigned>(min<rlim_t>(nofile.rlim_cur / shares, 1U << 15U))};
+        // Half of the slots at most are for one-off reads.
+        chunk = min(batch, slots / 2);
+        if (chunk < min_batch) {
+            cerr << "Batched /proc reads disabled: RLIMIT_NOFILE (" << nofile.rlim_cur << ") is too low for "
+                 << shares << " readers." << endl;
+            batched = false;
+            return;
+        }
+        if (!ring.register_sparse_files(slots)) {
+            cerr << "Batched /proc reads disabled: " << strerror(errno) << endl;
+            batched = false;
+            return;
+        }
+        persistent_slots = slots - chunk;
+        free_slots.reserve(persistent_slots);
+        for (auto i{persistent_slots}; i > 0; i--) {
+            free_slots.push_back(i - 1);
+        }
+
+        bufs.resize(chunk * buf_size);
+        paths.resize(chunk);
+        fixed_bufs = ring.register_buffer(bufs.data(), bufs.size());
+    }
+    /// Copying is not allowed.
+    ProcStatReader(const ProcStatReader &) = delete;
+
+    /// @return bool True if the reads are batched with io_uring.
+    [[nodiscard]] bool is_batched() const { return batched; }
+
+    /// Read the stat file of every process.
+    /// @tparam F
+    /// @param pids
+    /// @param f Called as 'f(pid, contents)' in no particular order. 'contents' is empty if the process is gone.
+    template <class F> void read_all(span<const pid_t> pids, F f) {
+        if (!batched) {
+            for (auto pid : pids) {
+                f(pid, dir.read(pid, "stat", sync_buf));
+            }
+            return;
+        }
+
+        tick++;
+        for (size_t start{0}; start < pids.size(); start += chunk) {
+            const auto part{pids.subspan(start, min<size_t>(chunk, pids.size() - start))};
+            unsigned requests{0};
+            for (unsigned k{0}; k < part.size(); k++) {
+                requests += queue(k, part[k]);
+            }
+            if (const auto r{ring.submit(requests)}; r < 0) {
+                cerr << "io_uring_enter failed: " << strerror(-r) << ". Reading /proc one by one from now on."
+                     << endl;
+                batched = false;
+                read_all(pids.subspan(start), f);
+                return;
+            }
+            ring.for_each_cqe([&](const io_uring_cqe &cqe) {
+                if ((cqe.user_data & 1U) != Op::read) {
+                    // A failed open is reported by the cancelled read.
+                    return;
+                }
+                const auto k{cqe.user_data >> 1U};
+                const auto pid{part[k]};
+                if (cqe.res < 0) {
+                    // The process is gone (ESRCH), or never could be opened (ECANCELED).
+                    drop(pid);
+                    f(pid, string_view{});
+                    return;
+                }
+                f(pid, string_view{&bufs[k * buf_size], static_cast<size_t>(cqe.res)});
+            });
+        }
+
+        // The processes that were not asked for are gone.
+        open_files.erase_if([this](auto & /* pid */, auto &o) {
+            if (o.tick == tick) {
+                return false;
+            }
+            free_slots.push_back(o.slot);
+            return true;
+        });
+    }
+};
+}; // namespace fprd
@@ -0,0 +1,40 @@
+/// @file Root.hpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+
+#pragma once
+
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+namespace fprd {
+using namespace ::std;
+
+/// The directory that every '/proc' and '/sys' path of the probes is resolved against. Empty for the live system.
+/// Defaults to the environment variable 'FPRD_PROBE_ROOT'. To run the probes against a fake tree (see
+/// 'ProcFixture'), set it before creating them: paths are resolved when a probe is created.
+/// @return string&
+string &probe_root() {
+    static string root{[] {
+        const auto *const r{getenv("FPRD_PROBE_ROOT")};
+        return r == nullptr ? string{} : string{r};
+    }()};
+    return root;
+}
+
+/// @return bool True if the probes look at the running kernel, and not at a fake tree.
+bool is_live_system() { return probe_root().empty(); }
+
+/// @param path An absolute path on the live system, e.g. '/proc/stat'.
+/// @return string The same path under the probe root.
+string probe_path(string_view path) {
+    string p{probe_root()};
+    p += path;
+    return p;
+}
+}; // namespace fprd
@@ -0,0 +1,236 @@
+/// @file Taskstats.hpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+
+#pragma once
+
+#include <linux/genetlink.h>
+#include <linux/netlink.h>
+#include <linux/taskstats.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <dbg/Log.hpp>
+#include <fprd/probes/Root.hpp>
+#include <string>
+#include <string_view>
+
+namespace fprd {
+using namespace ::std;
+
+/// Exit accounting from the kernel's taskstats interface (generic netlink family "TASKSTATS").
+/// The kernel sends a 'taskstats' record with the final CPU time and peak RSS of every thread that exits, so
+/// processes that live shorter than a scan interval can still be accounted for.
+/// Registering a listener for a cpumask needs CAP_NET_ADMIN, and only works in the initial user and PID
+/// namespaces. Without them, the listener is quietly disabled ('valid' is false, the reason only shows in debug
+/// builds), and processes that exit between scans are not accounted for at all. Check 'valid' before using it.
+class TaskstatsListener {
+    /// The netlink socket. Negative if unavailable.
+    int fd;
+    /// Resolved id of the "TASKSTATS" family.
+    ushort family{0};
+    /// The CPUs we listen on, e.g. '0-15'.
+    string cpus;
+    /// Number of times the socket buffer overflowed.
+    size_t overflows{0};
+
+    /// A generic netlink request with room for one attribute.
+    struct Request {
+        nlmsghdr nl;
+        genlmsghdr genl;
+        array<byte, 1024> attrs;
+    };
+
+    /// Build and send a request with a single attribute.
+    /// @param type Generic netlink family.
+    /// @param cmd
+    /// @param attr
+    /// @param data
+    /// @param len
+    /// @return bool
+    bool send_request(ushort type, u_char cmd, ushort attr, const void *data, size_t len) {
+        Request req{};
+        auto *const na{reinterpret_cast<nlattr *>(req.attrs.data())};
+        if (NLA_HDRLEN + len > req.attrs.size()) {
+            return false;
+        }
+        na->nla_type = attr;
+        na->nla_len = NLA_HDRLEN + len;
+        memcpy(reinterpret_cast<byte *>(na) + NLA_HDRLEN, data, len);
+
+        req.nl.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN + NLA_ALIGN(na->nla_len));
+        req.nl.nlmsg_type = type;
+        req.nl.nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+        req.nl.nlmsg_pid = 0;
+        req.genl.cmd = cmd;
+        req.genl.version = 1;
+        return ::send(fd, &req, req.nl.nlmsg_len, 0) >= 0;
+    }
+
+    /// Wait for the reply to the last request.
+    /// @tparam F
+    /// @param f Called as 'f(attr type, payload)' for each top-level attribute of the reply, if any.
+    /// @return bool False if the kernel refused the request.
+    template <class F> bool receive_reply(F f) {
+        alignas(nlmsghdr) array<byte, 4096> buf;
+        while (true) {
+            const auto n{::recv(fd, buf.data(), buf.size(), 0)};
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            auto len{static_cast<unsigned int>(n)};
+            for (auto *nl{reinterpret_cast<nlmsghdr *>(buf.data())}; NLMSG_OK(nl, len); nl = NLMSG_NEXT(nl, len)) {
+                if (nl->nlmsg_type == NLMSG_ERROR) {
+                    // Also used for the ack. 'error' is 0 then.
+                    const auto *const err{static_cast<const nlmsgerr *>(NLMSG_DATA(nl))};
+                    errno = -err->error;
+                    return err->error == 0;
+                }
+                for_each_attr(attrs_of(nl), f);
+            }
+        }
+    }
+
+    /// @param nl
+    /// @return string_view The attributes of a generic netlink message.
+    static string_view attrs_of(const nlmsghdr *nl) {
+        return {static_cast<const char *>(NLMSG_DATA(nl)) + GENL_HDRLEN, NLMSG_PAYLOAD(nl, GENL_HDRLEN)};
+    }
+
+    /// Call 'f(type, payload)' for each attribute in a sequence.
+    /// @tparam F
+    /// @param attrs
+    /// @param f
+    template <class F> static void for_each_attr(string_view attrs, F &&f) {
+        while (attrs.size() >= NLA_HDRLEN) {
+            nlattr na;
+            memcpy(&na, attrs.data(), sizeof(na));
+            if (na.nla_len < NLA_HDRLEN || na.nla_len > attrs.size()) {
+                return;
+            }
+            f(na.nla_type & NLA_TYPE_MASK, attrs.substr(NLA_HDRLEN, na.nla_len - NLA_HDRLEN));
+            attrs.remove_prefix(min<size_t>(NLA_ALIGN(na.nla_len), attrs.size()));
+        }
+    }
+
+    /// Give up on taskstats.
+    /// @param what
+    void disable(const char *what) {
+        dbg_out("Taskstats unavailable (" << what << "): " << strerror(errno));
+        ::close(fd);
+        fd = -1;
+    }
+
+  public:
+    /// @param cpus The CPUs to listen on, in the format of '/sys/devices/system/cpu/online'.
+    TaskstatsListener(string cpus)
+        // The records are about the running kernel, so they are useless for a fake tree.
+        : fd{is_live_system() ? ::socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC) : -1},
+          cpus{move(cpus)} {
+        if (fd < 0) {
+            return;
+        }
+        sockaddr_nl addr{};
+        addr.nl_family = AF_NETLINK;
+        if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+            disable("bind");
+            return;
+        }
+        // Bursts of exits can easily fill the default buffer.
+        const int rcvbuf{1 << 20};
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+        const string_view name{TASKSTATS_GENL_NAME};
+        if (!send_request(GENL_ID_CTRL, CTRL_CMD_GETFAMILY, CTRL_ATTR_FAMILY_NAME, name.data(), name.size() + 1) ||
+            !receive_reply([this](ushort type, string_view payload) {
+                if (type == CTRL_ATTR_FAMILY_ID && payload.size() >= sizeof(family)) {
+                    memcpy(&family, payload.data(), sizeof(family));
+                }
+            }) ||
+            family == 0) {
+            disable("family");
+            return;
+        }
+
+        // Fails with EPERM without CAP_NET_ADMIN, and outside of the initial namespaces, e.g. in most containers.
+        if (!send_request(family, TASKSTATS_CMD_GET, TASKSTATS_CMD_ATTR_REGISTER_CPUMASK, this->cpus.c_str(),
+                          this->cpus.size() + 1) ||
+            !receive_reply([](ushort /* type */, string_view /* payload */) {})) {
+            disable("register");
+        }
+    }
+    /// Copying is not allowed.
+    TaskstatsListener(const TaskstatsListener &) = delete;
+
+    ~TaskstatsListener() {
+        if (fd >= 0) {
+            send_request(family, TASKSTATS_CMD_GET, TASKSTATS_CMD_ATTR_DEREGISTER_CPUMASK, cpus.c_str(),
+                         cpus.size() + 1);
+            ::close(fd);
+        }
+    }
+
+    /// @return bool True if we are receiving exit records.
+    [[nodiscard]] bool valid() const { return fd >= 0; }
+
+    /// @return size_t Number of times exit records were lost.
+    [[nodiscard]] size_t overflow_count() const { return overflows; }
+
+    /// Handle every pending exit record without blocking.
+    /// There is one record per thread. 'ac_tgid' tells which process it belonged to.
+    /// @tparam F
+    /// @param f Called as 'f(const taskstats &)'.
+    template <class F> void drain(F f) {
+        alignas(nlmsghdr) array<byte, 1 << 16> buf;
+        while (true) {
+            const auto n{::recv(fd, buf.data(), buf.size(), MSG_DONTWAIT)};
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == ENOBUFS) {
+                    overflows++;
+                    continue;
+                }
+                return;
+            }
+            auto len{static_cast<unsigned int>(n)};
+            for (auto *nl{reinterpret_cast<nlmsghdr *>(buf.data())}; NLMSG_OK(nl, len); nl = NLMSG_NEXT(nl, len)) {
+                if (nl->nlmsg_type != family) {
+                    continue;
+                }
+                // TASKSTATS_TYPE_AGGR_PID { TASKSTATS_TYPE_PID, TASKSTATS_TYPE_STATS }.
+                // The per-process TASKSTATS_TYPE_AGGR_TGID only carries delay accounting, so it is ignored.
+                for_each_attr(attrs_of(nl), [&f](ushort type, string_view aggr) {
+                    if (type != TASKSTATS_TYPE_AGGR_PID) {
+                        return;
+                    }
+                    for_each_attr(aggr, [&f](ushort type, string_view payload) {
+                        if (type != TASKSTATS_TYPE_STATS) {
+                            return;
+                        }
+                        // The payload is only 4-byte aligned, and older kernels send a shorter struct.
+                        taskstats ts{};
+                        memcpy(&ts, payload.data(), min(payload.size(), sizeof(ts)));
+                        if (ts.ac_tgid == 0) {
+                            ts.ac_tgid = ts.ac_pid;
+                        }
+                        f(as_const(ts));
+                    });
+                });
+            }
+        }
+    }
+};
+}; // namespace fprd
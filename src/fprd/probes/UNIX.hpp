@@ -10,30 +10,102 @@
 
 #include <unistd.h>
 
+#include <algorithm>
+#include <array>
+#include <charconv>
 #include <cstdio>
 #include <cstdlib>
 #include <dbg/Log.hpp>
-#include <fstream>
-#include <istream>
+#include <fprd/util/file.hpp>
+#include <fprd/util/scanner.hpp>
 #include <string>
 
 namespace fprd {
 using namespace std;
 
-string get_name(pid_t pid) {
-    using namespace std::filesystem;
-    const path file{"/proc/" + to_string(pid) + "/stat"};
-    if (!exists(file)) {
-        return "<E: Missing file>";
+/// Build '<prefix><pid>/<file>' without allocating.
+/// @tparam size Of the buffer. Longer paths are cut off.
+/// @param prefix
+/// @param pid
+/// @param file
+/// @return auto Null-terminated path.
+template <size_t size = 64> auto pid_path(string_view prefix, pid_t pid, string_view file) {
+    array<char, size> path;
+    auto *const e{path.data() + path.size() - 1};
+    auto *p{copy_n(prefix.data(), min(prefix.size(), static_cast<size_t>(e - path.data())), path.data())};
+    p = to_chars(p, e, pid).ptr;
+    if (p != e) {
+        *p++ = '/';
     }
-    ifstream ifs{file};
-    ifs.ignore(numeric_limits<streamsize>::max(), '(');
-    return [&]() {
-        string name;
-        for (char c; ifs >> c, c != ')';) {
-            name += c;
-        }
-        return name;
-    }();
+    p = copy_n(file.data(), min(file.size(), static_cast<size_t>(e - p)), p);
+    *p = '\0';
+    return path;
+}
+
+/// The fields of '/proc/<pid>/stat' that we use. See proc(5).
+struct ProcStat {
+    pid_t pid;
+    array<char, 64> comm; // Null-terminated. Usually up to 15 characters, but kernel workers get longer names.
+    char state;
+    ulong utime;  // Clock ticks.
+    ulong stime;  // Clock ticks.
+    long cutime;  // Clock ticks.
+    long cstime;  // Clock ticks.
+    ulong start;  // Clock ticks since boot.
+    long rss;     // Pages.
+
+    [[nodiscard]] string_view name() const { return comm.data(); }
+
+    /// @return long Lifetime CPU usage, including waited-for children.
+    [[nodiscard]] long cpu_time() const { return static_cast<long>(utime + stime) + cutime + cstime; }
+    /// @return long Lifetime CPU usage of the process itself.
+    [[nodiscard]] long own_cpu_time() const { return static_cast<long>(utime + stime); }
+};
+
+/// Parse '/proc/<pid>/stat' in one pass.
+/// @param stat The contents of the file.
+/// @return ProcStat 'pid' is 0 if 'stat' is empty (e.g. the process exited).
+ProcStat parse_proc_stat(string_view stat) {
+    ProcStat p{};
+    Scanner s{stat};
+    p.pid = s.getint();
+    s.skip_to('(');
+    {
+        // The name itself may contain ')'.
+        const auto rest{s.rest()};
+        const auto name{rest.substr(0, rest.rfind(')'))};
+        copy_n(name.data(), min(name.size(), p.comm.size() - 1), p.comm.data());
+    }
+    s.skip_to_last(')');
+    p.state = s.getchar();
+    // ppid, pgrp, session, tty_nr, tpgid, flags, minflt, cminflt, majflt, cmajflt.
+    for (auto i{0}; i < 10; i++) {
+        s.getlong();
+    }
+    p.utime = s.getulong();
+    p.stime = s.getulong();
+    p.cutime = s.getlong();
+    p.cstime = s.getlong();
+    // priority, nice, num_threads, itrealvalue.
+    for (auto i{0}; i < 4; i++) {
+        s.getlong();
+    }
+    p.start = s.getulong();
+    s.getulong(); // vsize
+    p.rss = s.getlong();
+    return p;
+}
+
+/// @param proc '/proc/', under the probe root of the caller.
+/// @param pid
+/// @param name Assigned, so that its memory is reused.
+void get_name(string_view proc, pid_t pid, string &name) {
+    array<char, 1024> buf;
+    const auto stat{read_file(pid_path<256>(proc, pid, "stat").data(), buf)};
+    if (stat.empty()) {
+        name = "<E: Missing file>";
+        return;
+    }
+    name = parse_proc_stat(stat).name();
 }
 }; // namespace fprd
\ No newline at end of file
@@ -0,0 +1,32 @@
+/// @file Allocations.cpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+///
+/// The global 'operator new' and 'operator delete' that count allocations (see Allocations.hpp). Only linked with
+/// '-DFPRD_COUNT_ALLOCATIONS=ON'. In a translation unit of their own: where the compiler can inline them, it sees
+/// memory from 'malloc' go to 'operator delete', and warns (-Wmismatched-new-delete).
+
+#include <cstdlib>
+#include <fprd/util/Allocations.hpp>
+#include <new>
+
+namespace fprd {
+thread_local size_t thread_allocations{0};
+}; // namespace fprd
+
+void *operator new(size_t size) {
+    fprd::thread_allocations++;
+    if (auto *const p{std::malloc(size == 0 ? 1 : size)}; p != nullptr) {
+        return p;
+    }
+    std::abort();
+}
+void *operator new[](size_t size) { return ::operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
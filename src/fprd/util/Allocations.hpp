@@ -0,0 +1,29 @@
+/// @file Allocations.hpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+///
+/// Counts heap allocations, for checking that the probes do not allocate once they are warmed up.
+/// Enabled with '-DFPRD_COUNT_ALLOCATIONS=ON', which defines 'FPRD_COUNT_ALLOCATIONS' and links Allocations.cpp,
+/// where the global 'operator new' is replaced.
+
+#pragma once
+
+#include <cstddef>
+
+namespace fprd {
+using namespace ::std;
+
+#ifdef FPRD_COUNT_ALLOCATIONS
+/// Allocations by the calling thread so far. Defined in Allocations.cpp.
+extern thread_local size_t thread_allocations;
+
+/// @return size_t Allocations by the calling thread so far. Always 0 unless 'FPRD_COUNT_ALLOCATIONS' is defined.
+inline size_t allocation_count() { return thread_allocations; }
+#else
+inline size_t allocation_count() { return 0; }
+#endif
+}; // namespace fprd
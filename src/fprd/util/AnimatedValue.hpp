@@ -8,22 +8,38 @@
 
 #pragma once
 
+#include <cmath>
 #include <fprd/Config.hpp>
 #include <fprd/Types.hpp>
+#include <fprd/Window.hpp>
 
 namespace fprd {
 template <number I> class AnimatedValue {
     I current{0};
-    I increment{0};
+    I from{0};
+    I target{0};
+    /// The smallest change that shows, e.g. 0.1 for a value printed with one decimal.
+    float resolution;
 
   public:
+    /// @param resolution The smallest change that shows.
+    AnimatedValue(float resolution = 1) : resolution{resolution} {}
+
+    /// The value moves there from where it is until the next update.
+    /// @param target_value
     void update(I target_value) {
-        increment = (static_cast<float>(target_value) - static_cast<float>(current)) / fps;
+        from = current;
+        target = target_value;
     }
 
-    I draw() {
-        current += increment;
+    /// Call this every frame.
+    /// @param w
+    /// @return I
+    I draw(Window &w) {
+        const auto d{static_cast<float>(target) - static_cast<float>(from)};
+        w.animate(abs(d) / resolution);
+        current = static_cast<I>(static_cast<float>(from) + d * w.progress);
         return current;
     }
 };
-}; // namespace fprd
\ No newline at end of file
+}; // namespace fprd
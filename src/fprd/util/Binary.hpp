@@ -0,0 +1,141 @@
+/// @file Binary.hpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace fprd {
+using namespace ::std;
+
+/// Types that list their members for serialization with a static 'fields(s)', returning 'tie(s.a, s.b, ...)'.
+/// It is static so that one definition serves both const and non-const objects.
+/// @tparam T
+template <class T>
+concept has_fields = requires(T &t, const T &ct) {
+    T::fields(t);
+    T::fields(ct);
+};
+
+/// Types that can be written as they are in memory.
+/// @tparam T
+template <class T>
+concept raw_bytes = is_trivially_copyable_v<T> && !has_fields<T>;
+
+/// Writes values in a compact binary format:
+/// - Types with 'fields' are written field by field.
+/// - 'string' and 'vector' are a u32 element count followed by the elements.
+/// - Anything else that is trivially copyable is written as it is in memory, i.e. in the native byte order.
+class BinaryWriter {
+    ostream &os;
+
+  public:
+    /// @param os Should be opened in binary mode.
+    BinaryWriter(ostream &os) : os{os} {}
+
+    /// @tparam T
+    /// @param t
+    template <raw_bytes T> void write(const T &t) { os.write(reinterpret_cast<const char *>(&t), sizeof(T)); }
+
+    /// @param s
+    void write(const string &s) {
+        write(static_cast<uint32_t>(s.size()));
+        os.write(s.data(), static_cast<streamsize>(s.size()));
+    }
+
+    /// @tparam T
+    /// @param v
+    template <class T> void write(const vector<T> &v) {
+        write(static_cast<uint32_t>(v.size()));
+        if constexpr (raw_bytes<T>) {
+            os.write(reinterpret_cast<const char *>(v.data()), static_cast<streamsize>(v.size() * sizeof(T)));
+        } else {
+            for (const auto &t : v) {
+                write(t);
+            }
+        }
+    }
+
+    /// @tparam T
+    /// @param t
+    template <has_fields T> void write(const T &t) {
+        apply([this](const auto &...f) { (write(f), ...); }, T::fields(t));
+    }
+
+    /// @return bool False if a write failed.
+    [[nodiscard]] bool good() const { return os.good(); }
+};
+
+/// Reads what 'BinaryWriter' wrote.
+class BinaryReader {
+    /// Upper bound for element counts, so that a corrupt file cannot make us allocate everything.
+    static constexpr uint32_t max_count{1U << 24U};
+
+    istream &is;
+
+    /// @return bool False if the count is unreadable or absurd.
+    bool read_count(uint32_t &n) { return read(n) && n <= max_count; }
+
+  public:
+    /// @param is Should be opened in binary mode.
+    BinaryReader(istream &is) : is{is} {}
+
+    /// @tparam T
+    /// @param t
+    /// @return bool False at the end of the stream or on errors. 't' is unspecified then.
+    template <raw_bytes T> bool read(T &t) {
+        return static_cast<bool>(is.read(reinterpret_cast<char *>(&t), sizeof(T)));
+    }
+
+    /// @param s
+    /// @return bool
+    bool read(string &s) {
+        uint32_t n;
+        if (!read_count(n)) {
+            return false;
+        }
+        s.resize(n);
+        return static_cast<bool>(is.read(s.data(), n));
+    }
+
+    /// @tparam T
+    /// @param v
+    /// @return bool
+    template <class T> bool read(vector<T> &v) {
+        uint32_t n;
+        if (!read_count(n)) {
+            return false;
+        }
+        v.resize(n);
+        if constexpr (raw_bytes<T>) {
+            return static_cast<bool>(
+                is.read(reinterpret_cast<char *>(v.data()), static_cast<streamsize>(n * sizeof(T))));
+        } else {
+            for (auto &t : v) {
+                if (!read(t)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    /// @tparam T
+    /// @param t
+    /// @return bool
+    template <has_fields T> bool read(T &t) {
+        return apply([this](auto &...f) { return (read(f) && ...); }, T::fields(t));
+    }
+};
+}; // namespace fprd
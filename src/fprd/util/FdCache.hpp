@@ -0,0 +1,148 @@
+/// @file FdCache.hpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <fprd/util/file.hpp>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace fprd {
+using namespace ::std;
+
+/// Keeps files with fixed paths (e.g. '/proc/stat') open, so that each read is a single 'pread' instead of
+/// open + read + close.
+/// Files that disappear (CPU or device hotplug) are reopened on the next read.
+class FdCache {
+  public:
+    /// Identifies a file registered with 'add'.
+    using Handle = size_t;
+
+  private:
+    /// A cached file.
+    struct Entry {
+        string path;
+        int fd;
+    };
+
+    vector<Entry> entries;
+
+    /// Reads that were served by an already opened fd.
+    size_t hits{0};
+    /// Times a file had to be opened again after it was first opened.
+    size_t reopens{0};
+
+    /// (Re)open the file if needed.
+    /// @param e
+    /// @return bool True if the file is open.
+    bool open(Entry &e) {
+        if (e.fd >= 0) {
+            return true;
+        }
+        e.fd = ::open(e.path.c_str(), O_RDONLY | O_CLOEXEC);
+        return e.fd >= 0;
+    }
+
+    /// Close the file so that the next read reopens it.
+    /// @param e
+    void close(Entry &e) {
+        if (e.fd >= 0) {
+            ::close(e.fd);
+            e.fd = -1;
+        }
+    }
+
+    /// Common logic for reading into any kind of buffer.
+    /// @tparam Read
+    /// @param h
+    /// @param read Reads from an fd. Must return a view whose 'data()' is 'nullptr' on errors.
+    /// @return string_view Same as 'FileBuffer::read'.
+    template <class Read> string_view read_with(Handle h, Read read) {
+        auto &e{entries[h]};
+        if (e.fd >= 0) {
+            if (const auto s{read(e.fd)}; s.data() != nullptr) {
+                hits++;
+                return s;
+            }
+            if (errno != ENOENT && errno != ENODEV) {
+                return {};
+            }
+            // The file is gone. It might come back as a new file, so try again.
+            close(e);
+            reopens++;
+        }
+        if (!open(e)) {
+            return {};
+        }
+        return read(e.fd);
+    }
+
+  public:
+    FdCache() = default;
+    /// Copying is not allowed.
+    FdCache(const FdCache &) = delete;
+    /// Moving is allowed, however.
+    FdCache(FdCache &&) noexcept = default;
+
+    ~FdCache() {
+        for (auto &e : entries) {
+            close(e);
+        }
+    }
+
+    /// Register a file. It is opened right away if possible.
+    /// @param path
+    /// @return Handle
+    Handle add(string path) {
+        entries.push_back({move(path), -1});
+        open(entries.back());
+        return entries.size() - 1;
+    }
+
+    /// Read the whole file.
+    /// @param h
+    /// @param buf
+    /// @return string_view Same as 'FileBuffer::read'.
+    string_view read(Handle h, FileBuffer &buf) {
+        return read_with(h, [&buf](int fd) { return buf.read_fd(fd); });
+    }
+
+    /// Read the file into a stack buffer. Anything that does not fit is cut off.
+    /// @tparam size
+    /// @param h
+    /// @param buf
+    /// @return string_view Same as 'FileBuffer::read'.
+    template <size_t size> string_view read(Handle h, array<char, size> &buf) {
+        return read_with(h, [&buf](int fd) -> string_view {
+            const auto r{read_all(fd, buf.data(), buf.size())};
+            if (r < 0) {
+                return {};
+            }
+            return {buf.data(), static_cast<size_t>(r)};
+        });
+    }
+
+    /// @return size_t Reads that were served without opening a file.
+    [[nodiscard]] size_t hit_count() const { return hits; }
+    /// @return size_t Times a file had to be reopened because it vanished.
+    [[nodiscard]] size_t reopen_count() const { return reopens; }
+
+    /// Print the statistics in a json-like format.
+    /// @param os
+    /// @return ostream&
+    ostream &print(ostream &os) const {
+        os << "{hits: " << hits << ", reopens: " << reopens << "}";
+        return os;
+    }
+};
+}; // namespace fprd
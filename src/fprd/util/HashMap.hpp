@@ -0,0 +1,194 @@
+/// @file HashMap.hpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace fprd {
+using namespace ::std;
+
+/// Hash function object for 'HashMap'.
+/// @tparam H
+/// @tparam K
+template <class H, class K>
+concept hasher = requires(const H &h, const K &k) {
+    { h(k) } -> convertible_to<size_t>;
+};
+
+/// Fibonacci hashing for integer keys such as PIDs.
+struct IntHash {
+    size_t operator()(integral auto k) const { return static_cast<size_t>(k) * 0x9e3779b97f4a7c15ULL >> 32U; }
+};
+
+/// Open-addressing hash map with linear probing.
+/// Erasing uses backward shifting instead of tombstones, so lookups never slow down no matter how many entries
+/// come and go. The table shrinks again when most of it is erased.
+/// @tparam K
+/// @tparam V Must be default constructible.
+/// @tparam Hash
+template <equality_comparable K, class V, hasher<K> Hash> class HashMap {
+    /// A bucket.
+    struct Slot {
+        K key;
+        V value;
+        bool used;
+    };
+
+    /// Capacity is always a power of 2 (or 0).
+    vector<Slot> slots;
+    size_t count{0};
+    Hash hash;
+
+    /// Never shrink below this.
+    static constexpr size_t min_capacity{64};
+
+    /// @param k
+    /// @return size_t The ideal bucket of 'k'.
+    [[nodiscard]] size_t home(const K &k) const { return hash(k) & (slots.size() - 1); }
+
+    /// @param i
+    /// @return size_t The next bucket.
+    [[nodiscard]] size_t next(size_t i) const { return (i + 1) & (slots.size() - 1); }
+
+    /// Rebuild the table with a new capacity.
+    /// @param capacity
+    void rehash(size_t capacity) {
+        auto old{move(slots)};
+        slots = vector<Slot>(capacity);
+        for (auto &s : old) {
+            if (!s.used) {
+                continue;
+            }
+            auto i{home(s.key)};
+            while (slots[i].used) {
+                i = next(i);
+            }
+            slots[i] = move(s);
+        }
+    }
+
+    /// Erase the entry at 'i', shifting back the rest of the cluster to fill the hole.
+    /// @param i
+    void erase_at(size_t i) {
+        slots[i].used = false;
+        count--;
+        for (auto j{next(i)}; slots[j].used; j = next(j)) {
+            const auto h{home(slots[j].key)};
+            // Only move the entry if its home is not cyclically inside (i, j].
+            const auto movable{i <= j ? (h <= i || j < h) : (h <= i && j < h)};
+            if (movable) {
+                slots[i] = move(slots[j]);
+                slots[j].used = false;
+                i = j;
+            }
+        }
+    }
+
+  public:
+    HashMap() = default;
+    /// Copying is not allowed.
+    HashMap(const HashMap &) = delete;
+    /// Moving is allowed, however.
+    HashMap(HashMap &&) noexcept = default;
+
+    /// @return size_t The number of entries.
+    [[nodiscard]] size_t size() const { return count; }
+    /// @return size_t The number of buckets.
+    [[nodiscard]] size_t capacity() const { return slots.size(); }
+
+    /// @param k
+    /// @return V* 'nullptr' if not found.
+    V *find(const K &k) {
+        if (count == 0) {
+            return nullptr;
+        }
+        for (auto i{home(k)}; slots[i].used; i = next(i)) {
+            if (slots[i].key == k) {
+                return &slots[i].value;
+            }
+        }
+        return nullptr;
+    }
+
+    /// Find the entry for 'k', inserting a value-initialized one if there is none.
+    /// @param k
+    /// @return pair<V &, bool> The entry and whether it was inserted.
+    pair<V &, bool> try_emplace(const K &k) {
+        // Keep the load factor under 1/2.
+        if ((count + 1) * 2 > slots.size()) {
+            rehash(max(min_capacity, slots.size() * 2));
+        }
+        auto i{home(k)};
+        for (; slots[i].used; i = next(i)) {
+            if (slots[i].key == k) {
+                return {slots[i].value, false};
+            }
+        }
+        slots[i] = {k, V{}, true};
+        count++;
+        return {slots[i].value, true};
+    }
+
+    /// Erase the entry for 'k', if there is one.
+    /// @param k
+    /// @return bool Whether something was erased.
+    bool erase(const K &k) {
+        if (count == 0) {
+            return false;
+        }
+        for (auto i{home(k)}; slots[i].used; i = next(i)) {
+            if (slots[i].key == k) {
+                erase_at(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Erase everything, keeping the memory.
+    void clear() {
+        for (auto &s : slots) {
+            s.used = false;
+        }
+        count = 0;
+    }
+
+    /// Call 'f(key, value)' for every entry.
+    /// @tparam F
+    /// @param f
+    template <class F> void for_each(F f) {
+        for (auto &s : slots) {
+            if (s.used) {
+                f(as_const(s.key), s.value);
+            }
+        }
+    }
+
+    /// Erase every entry for which 'pred(key, value)' holds.
+    /// @tparam Pred
+    /// @param pred
+    template <class Pred> void erase_if(Pred pred) {
+        for (size_t i{0}; i < slots.size(); i++) {
+            // Erasing may shift an unvisited entry into 'i', so check it again.
+            while (slots[i].used && pred(as_const(slots[i].key), as_const(slots[i].value))) {
+                erase_at(i);
+            }
+        }
+        // Give back memory after a burst of entries is gone.
+        if (slots.size() > min_capacity && count * 8 < slots.size()) {
+            rehash(max(min_capacity, bit_ceil(count * 4)));
+        }
+    }
+};
+}; // namespace fprd
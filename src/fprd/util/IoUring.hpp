@@ -0,0 +1,204 @@
+/// @file IoUring.hpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+
+#pragma once
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <dbg/Log.hpp>
+
+namespace fprd {
+using namespace ::std;
+
+/// A bare-bones io_uring, talking to the kernel directly (no liburing).
+/// Only what is needed for batching file reads: queue SQEs, submit them all with one syscall and walk the CQEs.
+/// Check 'valid' before using it: io_uring may be missing or disabled (e.g. by seccomp).
+class IoUring {
+    /// The ring. Negative if unavailable.
+    int fd{-1};
+
+    /// Both rings share one mapping ('IORING_FEAT_SINGLE_MMAP').
+    void *rings{MAP_FAILED};
+    size_t rings_size{0};
+    io_uring_sqe *sqes{static_cast<io_uring_sqe *>(MAP_FAILED)};
+    size_t sqes_size{0};
+
+    /// Submission queue.
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned sq_mask;
+    unsigned *sq_array;
+    unsigned sq_entries;
+    /// Our copy of the SQ tail. Published on 'submit'.
+    unsigned sq_local_tail{0};
+
+    /// Completion queue.
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    io_uring_cqe *cqes;
+
+    /// @param offset
+    /// @return T* A field of the shared rings.
+    template <class T> T *ring_field(unsigned offset) {
+        return reinterpret_cast<T *>(static_cast<char *>(rings) + offset);
+    }
+
+    /// Give up on io_uring.
+    /// @param what
+    void disable(const char *what) {
+        dbg_out("io_uring unavailable (" << what << "): " << strerror(errno));
+        release();
+    }
+
+    /// Unmap and close everything.
+    void release() {
+        if (sqes != MAP_FAILED) {
+            ::munmap(sqes, sqes_size);
+            sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+        }
+        if (rings != MAP_FAILED) {
+            ::munmap(rings, rings_size);
+            rings = MAP_FAILED;
+        }
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+
+  public:
+    /// @param entries Size of the submission queue. Rounded up to a power of 2 by the kernel.
+    IoUring(unsigned entries) {
+        io_uring_params p{};
+        // Not IORING_SETUP_SINGLE_ISSUER: rings are created on one thread and used on another.
+        p.flags = IORING_SETUP_COOP_TASKRUN;
+        fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &p));
+        if (fd < 0 && errno == EINVAL) {
+            // Older kernel. Try again without the hints.
+            p = {};
+            fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &p));
+        }
+        if (fd < 0) {
+            disable("setup");
+            return;
+        }
+        if ((p.features & IORING_FEAT_SINGLE_MMAP) == 0) {
+            errno = ENOTSUP;
+            disable("features");
+            return;
+        }
+
+        rings_size = max(p.sq_off.array + p.sq_entries * sizeof(unsigned),
+                         p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe));
+        rings = ::mmap(nullptr, rings_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                       IORING_OFF_SQ_RING);
+        sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+        sqes = static_cast<io_uring_sqe *>(
+            ::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+        if (rings == MAP_FAILED || sqes == MAP_FAILED) {
+            disable("mmap");
+            return;
+        }
+
+        sq_head = ring_field<unsigned>(p.sq_off.head);
+        sq_tail = ring_field<unsigned>(p.sq_off.tail);
+        sq_mask = *ring_field<unsigned>(p.sq_off.ring_mask);
+        sq_array = ring_field<unsigned>(p.sq_off.array);
+        sq_entries = p.sq_entries;
+        sq_local_tail = *sq_tail;
+        cq_head = ring_field<unsigned>(p.cq_off.head);
+        cq_tail = ring_field<unsigned>(p.cq_off.tail);
+        cq_mask = *ring_field<unsigned>(p.cq_off.ring_mask);
+        cqes = ring_field<io_uring_cqe>(p.cq_off.cqes);
+    }
+    /// Copying is not allowed.
+    IoUring(const IoUring &) = delete;
+
+    ~IoUring() { release(); }
+
+    /// @return bool True if the ring can be used.
+    [[nodiscard]] bool valid() const { return fd >= 0; }
+
+    /// @return unsigned The number of SQEs that can be queued before 'submit'.
+    [[nodiscard]] unsigned capacity() const { return sq_entries; }
+
+    /// Queue a request. It is zeroed, and sent to the kernel on the next 'submit'.
+    /// @return io_uring_sqe* 'nullptr' if the queue is full.
+    io_uring_sqe *get_sqe() {
+        const auto head{atomic_ref{*sq_head}.load(memory_order_acquire)};
+        if (sq_local_tail - head >= sq_entries) {
+            return nullptr;
+        }
+        const auto i{sq_local_tail & sq_mask};
+        sq_array[i] = i;
+        sq_local_tail++;
+        auto *const sqe{&sqes[i]};
+        memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    /// Submit everything queued, and wait until at least 'wait_nr' completions are available.
+    /// @param wait_nr
+    /// @return int The number of submitted requests, or a negative errno.
+    int submit(unsigned wait_nr = 0) {
+        const auto to_submit{sq_local_tail - *sq_tail};
+        atomic_ref{*sq_tail}.store(sq_local_tail, memory_order_release);
+        while (true) {
+            const auto r{::syscall(__NR_io_uring_enter, fd, to_submit, wait_nr,
+                                   wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0U, nullptr, 0)};
+            if (r < 0 && errno == EINTR) {
+                continue;
+            }
+            return r < 0 ? -errno : static_cast<int>(r);
+        }
+    }
+
+    /// Consume every available completion.
+    /// @tparam F
+    /// @param f Called as 'f(const io_uring_cqe &)'.
+    /// @return unsigned The number of completions.
+    template <class F> unsigned for_each_cqe(F f) {
+        auto head{*cq_head};
+        const auto tail{atomic_ref{*cq_tail}.load(memory_order_acquire)};
+        const auto n{tail - head};
+        for (; head != tail; head++) {
+            f(as_const(cqes[head & cq_mask]));
+        }
+        atomic_ref{*cq_head}.store(head, memory_order_release);
+        return n;
+    }
+
+    /// Make room for 'n' fixed files, to be filled by requests that open files directly into the table.
+    /// @param n
+    /// @return bool
+    bool register_sparse_files(unsigned n) {
+        io_uring_rsrc_register r{};
+        r.nr = n;
+        r.flags = IORING_RSRC_REGISTER_SPARSE;
+        return ::syscall(__NR_io_uring_register, fd, IORING_REGISTER_FILES2, &r, sizeof(r)) == 0;
+    }
+
+    /// Register one buffer for 'IORING_OP_READ_FIXED' (as buffer index 0).
+    /// @param buf
+    /// @param size
+    /// @return bool False if e.g. RLIMIT_MEMLOCK is too low.
+    bool register_buffer(void *buf, size_t size) {
+        const iovec iov{buf, size};
+        return ::syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, &iov, 1) == 0;
+    }
+};
+}; // namespace fprd
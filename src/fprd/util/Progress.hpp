@@ -0,0 +1,50 @@
+/// @file Progress.hpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fprd/Config.hpp>
+
+namespace fprd {
+using namespace ::std;
+
+/// How far the animation between two updates is.
+/// An animation takes as many frames as there were between the previous two updates, so it ends about when the
+/// next update comes, whatever the probe interval is. Frames are counted whether they are drawn or skipped.
+class Progress {
+    uint64_t last{0};     // The frame of the last update.
+    uint64_t frames{fps}; // Of the current animation. One second until there were two updates.
+    bool started{false};
+
+  public:
+    /// Call on every update.
+    /// @param frame The first frame that shows it.
+    void restart(uint64_t frame) {
+        if (started) {
+            frames = max<uint64_t>(frame - last, 1);
+        }
+        started = true;
+        last = frame;
+    }
+
+    /// @param frame
+    /// @return float From '1 / frames' at the frame of the update, to 1 when done. Stays at 1 until the next one.
+    [[nodiscard]] float at(uint64_t frame) const {
+        return min(1.0F, static_cast<float>(frame + 1 - last) / static_cast<float>(frames));
+    }
+
+    /// @param p Above 0.
+    /// @return uint64_t The first frame that is at least 'p' far.
+    [[nodiscard]] uint64_t frame_at(float p) const {
+        return last + static_cast<uint64_t>(ceil(p * static_cast<float>(frames))) - 1;
+    }
+};
+}; // namespace fprd
@@ -0,0 +1,75 @@
+/// @file TopK.hpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <span>
+#include <type_traits>
+
+namespace fprd {
+using namespace ::std;
+
+/// Keeps the 'k' largest items pushed so far, in a fixed-size min-heap.
+/// Use it instead of collecting everything into a vector and sorting: each push is O(log k) and nothing is
+/// allocated.
+/// @tparam T
+/// @tparam k
+/// @tparam Key Projection to the sort key, e.g. CPU usage or memory. Larger keys are kept.
+template <class T, size_t k, class Key>
+requires totally_ordered<invoke_result_t<Key, const T &>>
+class TopK {
+    /// The smallest kept item is at the front.
+    array<T, k> heap;
+    size_t count{0};
+    Key key;
+
+    /// Heap order: the item with the smallest key on top.
+    /// @param l
+    /// @param r
+    /// @return bool
+    bool greater(const T &l, const T &r) const { return key(l) > key(r); }
+
+  public:
+    /// @param key
+    TopK(Key key = {}) : key{key} {}
+
+    /// Offer an item. It is only kept if it is among the 'k' largest so far.
+    /// @param t
+    void push(const T &t) {
+        const auto cmp{[this](const T &l, const T &r) { return greater(l, r); }};
+        if (count < k) {
+            heap[count++] = t;
+            push_heap(heap.begin(), heap.begin() + count, cmp);
+            return;
+        }
+        if (!greater(t, heap.front())) {
+            return;
+        }
+        pop_heap(heap.begin(), heap.end(), cmp);
+        heap.back() = t;
+        push_heap(heap.begin(), heap.end(), cmp);
+    }
+
+    /// @return size_t The number of kept items.
+    [[nodiscard]] size_t size() const { return count; }
+
+    /// Forget everything.
+    void clear() { count = 0; }
+
+    /// Sort the kept items, largest first.
+    /// WARNING: Invalidates the heap. Call 'clear' before pushing again.
+    /// @return span<T>
+    span<T> sorted() {
+        sort_heap(heap.begin(), heap.begin() + count, [this](const T &l, const T &r) { return greater(l, r); });
+        return {heap.data(), count};
+    }
+};
+}; // namespace fprd
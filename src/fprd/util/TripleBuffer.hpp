@@ -0,0 +1,64 @@
+/// @file TripleBuffer.hpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+
+#pragma once
+
+#include <sys/types.h>
+
+#include <array>
+#include <atomic>
+
+namespace fprd {
+using namespace ::std;
+
+/// Hands the latest value from one producer thread to one consumer thread, without locks or copies.
+/// The producer fills the back buffer and publishes it by swapping it with the middle one. The consumer takes the
+/// middle one by swapping it with the front one. Each side only ever touches its own buffer, so neither waits for
+/// the other, and values that the consumer was too slow for are simply overwritten.
+/// The memory orders are checked under contention by the 'triple-buffer' test (bench/TripleBuffer.cpp). Run it
+/// after any change here.
+/// @tparam T
+template <class T> class TripleBuffer {
+    array<T, 3> bufs{};
+    /// The index of the middle buffer, with 'fresh' set if it was published and not taken yet.
+    atomic<u_char> middle{1};
+    /// Only used by the producer.
+    u_char back{0};
+    /// Only used by the consumer.
+    u_char front{2};
+
+    static constexpr u_char fresh{4};
+    static constexpr u_char index{3};
+
+  public:
+    TripleBuffer() = default;
+    /// Copying is not allowed.
+    TripleBuffer(const TripleBuffer &) = delete;
+
+    /// For the producer. What it left there before is still there, so its memory can be reused.
+    /// @return T&
+    T &back_buffer() { return bufs[back]; }
+
+    /// For the producer. Make the back buffer the latest value.
+    void publish() { back = middle.exchange(back | fresh, memory_order_acq_rel) & index; }
+
+    /// For the consumer. Switch the front buffer to the latest value, if there is a new one.
+    /// @return bool False if nothing was published since the last call.
+    bool take() {
+        if ((middle.load(memory_order_relaxed) & fresh) == 0) {
+            return false;
+        }
+        front = middle.exchange(front, memory_order_acq_rel) & index;
+        return true;
+    }
+
+    /// For the consumer. It may take the memory of the value (e.g. by swapping), which the producer then reuses.
+    /// @return T& The value of the last 'take'. Value-initialized before the first one.
+    T &front_buffer() { return bufs[front]; }
+};
+}; // namespace fprd
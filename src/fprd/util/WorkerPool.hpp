@@ -0,0 +1,106 @@
+/// @file WorkerPool.hpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fprd {
+using namespace ::std;
+
+/// A fixed set of threads that each run one part of a job, on demand.
+/// Between jobs the workers sleep on a condition variable, so an idle pool costs nothing.
+class WorkerPool {
+    /// Excludes the calling thread, which always takes part 0.
+    vector<thread> workers;
+
+    mutex m;
+    condition_variable start;
+    condition_variable done;
+    /// The current job. Only valid while 'run' is running.
+    function<void(size_t)> job;
+    /// Bumped for every job, so that workers can tell a new job from a spurious wakeup.
+    size_t generation{0};
+    /// Workers that are not done with the current job yet.
+    size_t pending{0};
+    bool stopping{false};
+
+    /// @param i The part that this worker runs.
+    void work(size_t i) {
+        size_t seen{0};
+        unique_lock lk{m};
+        while (true) {
+            start.wait(lk, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+
+            lk.unlock();
+            job(i);
+            lk.lock();
+
+            if (--pending == 0) {
+                done.notify_one();
+            }
+        }
+    }
+
+  public:
+    /// @param size The number of parts of each job, including the one run by the calling thread.
+    WorkerPool(size_t size) {
+        for (size_t i{1}; i < size; i++) {
+            workers.emplace_back([this, i] { work(i); });
+        }
+    }
+    /// Copying is not allowed.
+    WorkerPool(const WorkerPool &) = delete;
+
+    ~WorkerPool() {
+        {
+            lock_guard lg{m};
+            stopping = true;
+        }
+        start.notify_all();
+        for (auto &w : workers) {
+            w.join();
+        }
+    }
+
+    /// @return size_t The number of parts of each job.
+    [[nodiscard]] size_t size() const { return workers.size() + 1; }
+
+    /// Run 'f(i)' for each part 'i' in parallel, and wait for all of them.
+    /// 'f(0)' runs on the calling thread.
+    /// @tparam F
+    /// @param f
+    template <class F> void run(F f) {
+        if (workers.empty()) {
+            f(0);
+            return;
+        }
+        {
+            lock_guard lg{m};
+            job = [&f](size_t i) { f(i); };
+            pending = workers.size();
+            generation++;
+        }
+        start.notify_all();
+
+        f(0);
+
+        unique_lock lk{m};
+        done.wait(lk, [this] { return pending == 0; });
+        job = nullptr;
+    }
+};
+}; // namespace fprd
@@ -0,0 +1,129 @@
+/// @file file.hpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <string_view>
+#include <vector>
+
+namespace fprd {
+using namespace ::std;
+
+/// Read everything from 'fd' into 'buf', starting at 'offset'.
+/// Uses 'pread', so the file position is irrelevant and the same fd can be read again and again.
+/// @param fd
+/// @param buf
+/// @param size
+/// @param offset
+/// @return ssize_t The number of bytes read, or -1 on error ('errno' is set).
+ssize_t read_all(int fd, char *buf, size_t size, off_t offset = 0) {
+    size_t total{0};
+    while (total < size) {
+        const auto r{::pread(fd, buf + total, size - total, offset + static_cast<off_t>(total))};
+        if (r < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (r == 0) {
+            break;
+        }
+        total += r;
+    }
+    return static_cast<ssize_t>(total);
+}
+
+/// A reusable buffer for reading small files, such as the ones in procfs and sysfs.
+/// The buffer only grows when a file does not fit, so it stops allocating once it has seen the largest file.
+class FileBuffer {
+    /// The storage.
+    vector<char> buf;
+
+  public:
+    /// @param initial_size Pick something large enough for the files you read to avoid growing at all.
+    FileBuffer(size_t initial_size = 4096) : buf(initial_size) {}
+    /// Copying is not allowed.
+    FileBuffer(const FileBuffer &) = delete;
+    /// Moving is allowed, however.
+    FileBuffer(FileBuffer &&) noexcept = default;
+
+    /// Read the whole file.
+    /// @param path
+    /// @return string_view The contents, invalidated by the next read. If the file could not be read (e.g. the
+    /// process exited), it is empty and its 'data()' is 'nullptr'.
+    string_view read(const char *path) { return read_at(AT_FDCWD, path); }
+
+    /// Read the whole file, relative to the directory 'dirfd'.
+    /// @param dirfd
+    /// @param path
+    /// @return string_view Same as 'read'.
+    string_view read_at(int dirfd, const char *path) {
+        const auto fd{::openat(dirfd, path, O_RDONLY | O_CLOEXEC)};
+        if (fd < 0) {
+            return {};
+        }
+        const auto s{read_fd(fd)};
+        ::close(fd);
+        return s;
+    }
+
+    /// Read everything from an opened file descriptor, from the beginning.
+    /// @param fd
+    /// @return string_view Same as 'read'. 'errno' is set on errors.
+    string_view read_fd(int fd) {
+        size_t total{0};
+        while (true) {
+            const auto r{read_all(fd, buf.data() + total, buf.size() - total, static_cast<off_t>(total))};
+            if (r < 0) {
+                return {};
+            }
+            total += r;
+            if (total < buf.size()) {
+                return {buf.data(), total};
+            }
+            // Did not fit. Grow and keep reading.
+            buf.resize(buf.size() * 2);
+        }
+    }
+};
+
+/// Read a small file into a stack buffer, relative to the directory 'dirfd'.
+/// Anything that does not fit is cut off.
+/// @tparam size
+/// @param dirfd
+/// @param path
+/// @param buf
+/// @return string_view The contents. Same as 'FileBuffer::read' on errors.
+template <size_t size> string_view read_file_at(int dirfd, const char *path, array<char, size> &buf) {
+    const auto fd{::openat(dirfd, path, O_RDONLY | O_CLOEXEC)};
+    if (fd < 0) {
+        return {};
+    }
+    const auto r{read_all(fd, buf.data(), buf.size())};
+    ::close(fd);
+    if (r < 0) {
+        return {};
+    }
+    return {buf.data(), static_cast<size_t>(r)};
+}
+
+/// Read a small file into a stack buffer. Anything that does not fit is cut off.
+/// @tparam size
+/// @param path
+/// @param buf
+/// @return string_view The contents. Same as 'FileBuffer::read' on errors.
+template <size_t size> string_view read_file(const char *path, array<char, size> &buf) {
+    return read_file_at(AT_FDCWD, path, buf);
+}
+}; // namespace fprd
@@ -0,0 +1,175 @@
+/// @file scanner.hpp
+/// @author FPR (funny.pig.run __ATMARK__ gmail.com)
+///
+/// @copyright Copyright (c) 2021
+///
+/// License: Proprietary.
+/// You may not use or share this file without the permission of the author.
+
+#pragma once
+
+#include <concepts>
+#include <cstring>
+#include <string_view>
+
+namespace fprd {
+using namespace ::std;
+
+/// A non-owning cursor over the text of a UNIX human-readable file.
+/// Mirrors the helpers in 'istream.hpp', but works on a plain buffer so that nothing is allocated and no locale
+/// machinery is involved. Delimiter searches go through 'memchr', which glibc vectorizes.
+/// Reading past the end is safe: numbers become 0 and views become empty.
+class Scanner {
+    /// Current position.
+    const char *p;
+    /// One past the last character.
+    const char *e;
+
+    /// @param delim
+    /// @return const char* The next 'delim', or 'e' if there is none.
+    [[nodiscard]] const char *find(char delim) const {
+        if (p == e) {
+            return e;
+        }
+        const auto *const c{static_cast<const char *>(memchr(p, delim, e - p))};
+        return c == nullptr ? e : c;
+    }
+
+  public:
+    /// @param s The text to scan. Must outlive the scanner.
+    constexpr Scanner(string_view s) : p{s.data()}, e{s.data() + s.size()} {}
+
+    /// @return bool True when everything has been consumed.
+    [[nodiscard]] bool empty() const { return p == e; }
+
+    /// @return string_view The part that has not been consumed yet.
+    [[nodiscard]] string_view rest() const { return {p, static_cast<size_t>(e - p)}; }
+
+    /// Move the cursor to right after the next 'delim'.
+    /// @param delim
+    void skip_to(char delim) {
+        const auto *const c{find(delim)};
+        p = c == e ? e : c + 1;
+    }
+
+    /// Move the cursor to right after the last 'delim'.
+    /// Needed for fields that may contain the delimiter, e.g. the process name in '/proc/<pid>/stat'.
+    /// @param delim
+    void skip_to_last(char delim) {
+        const auto *const c{p == e ? nullptr : static_cast<const char *>(memrchr(p, delim, e - p))};
+        p = c == nullptr ? e : c + 1;
+    }
+
+    /// Ignore the specified number of lines.
+    /// @param lines
+    void skip_lines(size_t lines) {
+        for (size_t i{0}; i < lines; i++) {
+            skip_to('\n');
+        }
+    }
+
+    /// Skip whitespace (including newlines).
+    void skip_ws() {
+        while (p != e && (*p == ' ' || *p == '\t' || *p == '\n')) {
+            p++;
+        }
+    }
+
+    /// @return string_view The rest of the current line, without the newline.
+    string_view getline() { return get_until('\n'); }
+
+    /// Read everything until 'delim'. The delimiter is consumed but not returned.
+    /// @param delim
+    /// @return string_view
+    string_view get_until(char delim) {
+        const auto *const c{find(delim)};
+        const string_view s{p, static_cast<size_t>(c - p)};
+        p = c == e ? e : c + 1;
+        return s;
+    }
+
+    /// Parse values from lines like 'key   : value'.
+    /// @return string_view Everything after the ':', with leading whitespace removed.
+    string_view getval() {
+        auto l{getline()};
+        const auto itr{l.find(':')};
+        if (itr == string_view::npos) {
+            return {};
+        }
+        l.remove_prefix(itr + 1);
+        while (!l.empty() && (l.front() == ' ' || l.front() == '\t')) {
+            l.remove_prefix(1);
+        }
+        return l;
+    }
+
+    /// @return char The next non-whitespace character.
+    char getchar() {
+        skip_ws();
+        if (p == e) {
+            return '\0';
+        }
+        return *p++;
+    }
+
+    /// @tparam U
+    /// @return U The next unsigned integer.
+    template <unsigned_integral U = ulong> U getunsigned() {
+        skip_ws();
+        U v{0};
+        for (; p != e && static_cast<unsigned char>(*p - '0') < 10; p++) {
+            v = v * 10 + static_cast<U>(*p - '0');
+        }
+        return v;
+    }
+
+    /// @return ulong
+    ulong getulong() { return getunsigned<ulong>(); }
+
+    /// @return uint
+    uint getuint() { return getunsigned<uint>(); }
+
+    /// @return long
+    long getlong() {
+        skip_ws();
+        if (p != e && *p == '-') {
+            p++;
+            return -static_cast<long>(getulong());
+        }
+        return static_cast<long>(getulong());
+    }
+
+    /// @return int
+    int getint() { return static_cast<int>(getlong()); }
+
+    /// Only handles plain decimal notation, which is all the kernel ever prints.
+    /// @return float
+    float getfloat() {
+        skip_ws();
+        const auto negative{p != e && *p == '-'};
+        if (negative) {
+            p++;
+        }
+        auto v{static_cast<float>(getulong())};
+        if (p != e && *p == '.') {
+            p++;
+            float scale{0.1F};
+            for (; p != e && static_cast<unsigned char>(*p - '0') < 10; p++, scale *= 0.1F) {
+                v += static_cast<float>(*p - '0') * scale;
+            }
+        }
+        return negative ? -v : v;
+    }
+};
+
+/// Parse a whole string as an unsigned integer.
+/// @tparam U
+/// @param s
+/// @return U
+template <unsigned_integral U = ulong> U stou(string_view s) { return Scanner{s}.getunsigned<U>(); }
+
+/// Parse a whole string as a float.
+/// @param s
+/// @return float
+float stof(string_view s) { return Scanner{s}.getfloat(); }
+}; // namespace fprd
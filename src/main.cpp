@@ -12,7 +12,10 @@
 #include <chrono>
 #include <csignal>
 #include <dbg/Log.hpp>
+#include <fprd/Record.hpp>
+#include <fprd/Scheduler.hpp>
 #include <fprd/Threads.hpp>
+#include <string_view>
 #include <thread>
 
 namespace fprd {
@@ -27,6 +30,20 @@ atomic<bool> run{true};
 /// @return auto
 auto stop(int signal) { run = false; }
 
+/// Where the data of the widgets comes from.
+enum class Mode : u_char {
+    live,          // The probes.
+    record,        // The probes, and it is written to files.
+    replay,        // Recorded files, at the recorded pace.
+    replay_unpaced // Recorded files, drawn as fast as possible and then exit.
+};
+
+/// @return int
+auto usage() {
+    cerr << "Usage: fprd [--record DIR | --replay DIR | --replay-unpaced DIR]" << endl;
+    return 1;
+}
+
 } // namespace fprd
 
 int main(int argc, char **argv) {
@@ -34,9 +51,64 @@ int main(int argc, char **argv) {
     std::signal(SIGINT, stop);
     std::signal(SIGKILL, stop);
 
-    GPUWindow gpus{run, {0, 0}};
-    CPUWindow cpu{run, CPUWindow::area.top_right({1920, 0})};
-    SystemWindow sys{run, SystemWindow::area.bottom_left({0, 1080})};
+    auto mode{Mode::live};
+    filesystem::path dir;
+    if (argc == 3) {
+        const string_view opt{argv[1]};
+        if (opt == "--record") {
+            mode = Mode::record;
+        } else if (opt == "--replay") {
+            mode = Mode::replay;
+        } else if (opt == "--replay-unpaced") {
+            mode = Mode::replay_unpaced;
+        } else {
+            return usage();
+        }
+        dir = argv[2];
+    } else if (argc != 1) {
+        return usage();
+    }
+
+    const Position<int> gpu_pos{0, 0};
+    const Position<int> cpu_pos{CPUWindow::area.top_right({1920, 0})};
+    const Position<int> sys_pos{SystemWindow::area.bottom_left({0, 1080})};
+    const auto gpu_log{dir / "gpu.fprd"};
+    const auto cpu_log{dir / "cpu.fprd"};
+    const auto sys_log{dir / "system.fprd"};
+
+    // Every window is driven from here, until 'run' is false.
+    Scheduler s{run, probe_threads};
+    switch (mode) {
+    case Mode::live: {
+        GPUWindow gpus{s, gpu_pos};
+        CPUWindow cpu{s, cpu_pos};
+        SystemWindow sys{s, sys_pos};
+        s.run();
+        break;
+    }
+    case Mode::record: {
+        filesystem::create_directories(dir);
+        RecordWindow<GPU> gpus{s, gpu_pos, gpu_log};
+        RecordWindow<CPU> cpu{s, cpu_pos, cpu_log};
+        RecordWindow<System> sys{s, sys_pos, sys_log};
+        s.run();
+        break;
+    }
+    case Mode::replay: {
+        ReplayWindow<GPU> gpus{s, gpu_pos, gpu_log};
+        ReplayWindow<CPU> cpu{s, cpu_pos, cpu_log};
+        ReplayWindow<System> sys{s, sys_pos, sys_log};
+        s.run();
+        break;
+    }
+    case Mode::replay_unpaced: {
+        // One after the other, so that the timings do not disturb each other.
+        Replay<GPU>{gpu_log, gpu_pos}.run_unpaced(run);
+        Replay<CPU>{cpu_log, cpu_pos}.run_unpaced(run);
+        Replay<System>{sys_log, sys_pos}.run_unpaced(run);
+        break;
+    }
+    }
 
     return 0;
 }
\ No newline at end of file